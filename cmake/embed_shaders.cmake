@@ -0,0 +1,29 @@
+# Turns every SPIR-V binary in SHADER_DIR into a C++ array so the renderer
+# can create its shader modules without touching the filesystem.
+#
+# usage: cmake -DSHADER_DIR=<dir> -DOUTPUT=<file.cpp> -P embed_shaders.cmake
+
+file(GLOB SHADER_FILES RELATIVE ${SHADER_DIR} ${SHADER_DIR}/*.spv)
+list(SORT SHADER_FILES)
+
+set(ARRAYS "")
+set(TABLE "")
+set(INDEX 0)
+foreach(SHADER ${SHADER_FILES})
+    file(READ ${SHADER_DIR}/${SHADER} HEX_CONTENT HEX)
+    file(SIZE ${SHADER_DIR}/${SHADER} SHADER_SIZE)
+    # 16 bytes per line keeps the lines short enough for editors and compilers
+    string(REPEAT "[0-9a-f]" 32 LINE_PATTERN)
+    string(REGEX REPLACE "(${LINE_PATTERN})" "\\1\n    " HEX_CONTENT "${HEX_CONTENT}")
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," BYTES "${HEX_CONTENT}")
+
+    string(APPEND ARRAYS "// ${SHADER}\nalignas(4) static const unsigned char SHADER_${INDEX}[] = {\n    ${BYTES}\n};\n\n")
+    string(APPEND TABLE "    { \"${SHADER}\", SHADER_${INDEX}, ${SHADER_SIZE} },\n")
+    math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+file(WRITE ${OUTPUT}.tmp
+"// Generated by cmake/embed_shaders.cmake, do not edit\n\n#include \"video/EmbeddedShaders.h\"\n\n${ARRAYS}const EmbeddedShader EMBEDDED_SHADERS[] = {\n${TABLE}    { nullptr, nullptr, 0 },\n};\n\nconst size_t EMBEDDED_SHADER_COUNT = ${INDEX};\n")
+# Only touch the output when it changed so dependents are not rebuilt
+configure_file(${OUTPUT}.tmp ${OUTPUT} COPYONLY)
+file(REMOVE ${OUTPUT}.tmp)
@@ -0,0 +1,41 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <condition_variable>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads consuming a FIFO of jobs
+class JobSystem
+{
+    private:
+        std::vector<std::thread> m_workers;
+        std::deque<std::function<void()>> m_jobs;
+        std::mutex m_mutex;
+        std::condition_variable m_job_available;
+        std::condition_variable m_jobs_done;
+        uint32_t m_pending = 0;
+        bool m_stopping = false;
+
+        void workerLoop();
+
+    public:
+        // thread_count 0 uses one worker per hardware thread
+        JobSystem(uint32_t thread_count = 0);
+        ~JobSystem();
+
+        uint32_t getThreadCount() const;
+
+        void submit(std::function<void()> job);
+        // Blocks until every submitted job has run
+        void wait();
+        // Runs job(i) for i in [0, count) on the workers and waits for all of them
+        void parallelFor(uint32_t count, const std::function<void(uint32_t)>& job);
+};
+
+#endif //JOB_SYSTEM_H
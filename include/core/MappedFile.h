@@ -0,0 +1,39 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. Mapped with mmap so the bytes are never
+// copied, read into memory on platforms without it.
+class MappedFile
+{
+    private:
+        const void* m_data = nullptr;
+        size_t m_size = 0;
+        // Only used when the file cannot be mapped
+        std::vector<char> m_copy;
+
+        void release();
+
+    public:
+        // Empty view, to be assigned a mapped file
+        MappedFile() = default;
+        // Throws std::runtime_error if the file cannot be opened
+        MappedFile(const std::string& path);
+        ~MappedFile();
+
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const void* getData() const;
+        size_t getSize() const;
+        // Asks the kernel to start reading the whole mapping in, so later
+        // reads from another thread do not stall on page faults
+        void prefetch() const;
+};
+
+#endif //MAPPED_FILE_H
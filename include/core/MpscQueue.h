@@ -0,0 +1,69 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// Unbounded multi-producer single-consumer queue (Vyukov's linked list with
+// a stub node). push is lock-free and may run on any thread, tryPop only on
+// the single consumer thread. A push is seen by tryPop once its link is
+// stored, a pop racing a push that has not linked yet reports empty.
+template<typename T>
+class MpscQueue
+{
+    private:
+        struct Node
+        {
+            std::atomic<Node*> next{ nullptr };
+            T value;
+        };
+
+        // Last pushed node, shared by the producers
+        std::atomic<Node*> m_head;
+        // Node before the next one to pop, consumer only
+        Node* m_tail;
+
+    public:
+        MpscQueue()
+        {
+            Node* stub = new Node();
+            m_head.store(stub, std::memory_order_relaxed);
+            m_tail = stub;
+        }
+
+        ~MpscQueue()
+        {
+            T value;
+            while (tryPop(value))
+            {
+            }
+            delete m_tail;
+        }
+
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+        void push(T value)
+        {
+            Node* node = new Node();
+            node->value = std::move(value);
+            Node* previous = m_head.exchange(node, std::memory_order_acq_rel);
+            previous->next.store(node, std::memory_order_release);
+        }
+
+        bool tryPop(T& value)
+        {
+            Node* next = m_tail->next.load(std::memory_order_acquire);
+            if (next == nullptr)
+            {
+                return false;
+            }
+            // next becomes the stub, its moved-from value is never read again
+            value = std::move(next->value);
+            delete m_tail;
+            m_tail = next;
+            return true;
+        }
+};
+
+#endif //MPSC_QUEUE_H
@@ -0,0 +1,54 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// CPU timing zones. With RENDERER_TRACE defined, TRACE_ZONE("name") times
+// the rest of the enclosing scope and records it into a ring owned by the
+// calling thread. Recording takes no lock, each thread only writes its own
+// ring and keeps its last TRACE_EVENTS_PER_THREAD zones. Without
+// RENDERER_TRACE the macro expands to nothing.
+// Names must be string literals or otherwise outlive the trace.
+
+const uint32_t TRACE_EVENTS_PER_THREAD = 1 << 15;
+
+// Monotonic time in nanoseconds
+uint64_t trace_now();
+void trace_record(const char* name, uint64_t start, uint64_t end);
+// Shown as the calling thread's name in the exported trace
+void trace_set_thread_name(const std::string& name);
+
+// Every thread's retained zones as Chrome trace event JSON, which
+// chrome://tracing and Perfetto open
+void trace_write_chrome_json(std::ostream& out);
+// Returns true on failure
+bool trace_write_chrome_json(const std::string& path);
+
+class TraceZone
+{
+    private:
+        const char* m_name;
+        uint64_t m_start;
+
+    public:
+        TraceZone(const char* name) : m_name(name), m_start(trace_now()) {}
+        ~TraceZone() { trace_record(m_name, m_start, trace_now()); }
+
+        TraceZone(const TraceZone&) = delete;
+        TraceZone& operator=(const TraceZone&) = delete;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef RENDERER_TRACE
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) trace_set_thread_name(name)
+#else
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
+
+#endif //TRACE_H
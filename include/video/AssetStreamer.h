@@ -0,0 +1,97 @@
+#ifndef ASSET_STREAMER_H
+#define ASSET_STREAMER_H
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "core/MappedFile.h"
+#include "core/MpscQueue.h"
+#include "video/MeshFile.h"
+#include "video/MeshRegistry.h"
+
+class JobSystem;
+
+// Index of a streaming request, valid for the streamer's lifetime
+typedef uint32_t StreamRequest;
+const StreamRequest INVALID_STREAM_REQUEST = UINT32_MAX;
+
+enum class StreamState : uint8_t {
+    Loading, // Read and decoded by a worker, or waiting for upload budget
+    Ready,   // Uploaded into the registry, the mesh can be drawn
+    Failed,
+};
+
+// Loads mesh files in the background. Workers read, decode, optimize and
+// quantize each file into the registry's vertex format, then hand the
+// finished block to the render thread through a lock-free queue. Binary
+// mesh files already in that format are only mapped and validated, their
+// blobs are copied from the mapping into staging by update(). The
+// render thread uploads ready blocks in update() up to a byte budget per
+// call, so a large scene streams in over several frames instead of
+// stalling one. request() and update() must run on the same thread.
+class AssetStreamer
+{
+    private:
+        // Ready to upload, vertices already in the registry's format
+        struct Block
+        {
+            StreamRequest request = INVALID_STREAM_REQUEST;
+            bool failed = false;
+            std::vector<uint8_t> vertices;
+            uint32_t vertex_count = 0;
+            std::vector<uint32_t> indices;
+            // Mesh file uploaded from its mapping when view is set, the
+            // vectors above are then unused
+            MappedFile file;
+            MeshFileView view;
+        };
+
+        struct Request
+        {
+            StreamState state = StreamState::Loading;
+            MeshHandle mesh = INVALID_MESH;
+        };
+
+        JobSystem* m_jobs;
+        bool m_optimize;
+        bool m_compact;
+        uint32_t m_max_index_value;
+        // Checked by queued jobs so shutdown does not wait for their decode
+        std::atomic<bool> m_stopping{ false };
+
+        MpscQueue<Block> m_ready;
+        // Popped blocks left over once the budget ran out, render thread only
+        std::deque<Block> m_pending;
+        std::vector<Request> m_requests;
+        uint32_t m_loading = 0;
+
+        void load(StreamRequest request, const std::string& path);
+        // Maps a mesh file into block, or decodes it into vertices and
+        // indices when its layout needs converting. Returns true on failure
+        bool mapMeshFile(const std::string& path, Block& block, std::vector<Vertex>& vertices);
+
+    public:
+        // optimize runs optimize_mesh on every mesh, compact quantizes them to
+        // CompactVertex. Both must match how the registry was created.
+        // Mesh files with 32 bit indices above max_index_value fail to load
+        AssetStreamer(uint32_t thread_count, bool optimize, bool compact, uint32_t max_index_value);
+        ~AssetStreamer();
+
+        // Queues the file for loading, .obj files are parsed, anything else
+        // is read as a binary mesh file
+        StreamRequest request(const std::string& path);
+        // Adds ready meshes to the registry until budget bytes were uploaded.
+        // At least one mesh goes per call, so one bigger than the budget
+        // still gets through. Returns the number of bytes uploaded
+        size_t update(MeshRegistry& meshes, size_t budget);
+
+        StreamState getState(StreamRequest request);
+        // INVALID_MESH unless the request is Ready. The caller owns the mesh
+        MeshHandle getMesh(StreamRequest request);
+        // Requests not Ready or Failed yet
+        uint32_t getLoadingCount();
+};
+
+#endif //ASSET_STREAMER_H
@@ -0,0 +1,56 @@
+#ifndef BINDLESS_TABLE_H
+#define BINDLESS_TABLE_H
+
+#include <vector>
+
+#include "video/renderer_struct.h"
+
+// Push constants of every bindless draw, indices into the table's arrays
+struct BindlessDrawConstants {
+    uint32_t uniform_buffer;
+    uint32_t uniform_index;
+};
+
+// One descriptor set holding large arrays of storage buffers and sampled
+// images (plus a shared sampler), bound once per command buffer. Shaders
+// pick their resources with indices from push constants. The arrays are
+// update-after-bind and partially bound, so slots can be written while the
+// set is in use by frames in flight, as long as those frames do not read them.
+class BindlessTable
+{
+    private:
+        VulkanContext& m_ctx;
+        VkDescriptorPool m_pool = VK_NULL_HANDLE;
+        VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+        VkDescriptorSet m_set = VK_NULL_HANDLE;
+        VkSampler m_sampler = VK_NULL_HANDLE;
+
+        uint32_t m_buffer_capacity;
+        uint32_t m_image_capacity;
+        uint32_t m_buffer_count = 0;
+        uint32_t m_image_count = 0;
+        std::vector<uint32_t> m_free_buffers;
+        std::vector<uint32_t> m_free_images;
+
+    public:
+        static const uint32_t STORAGE_BUFFER_BINDING = 0;
+        static const uint32_t SAMPLED_IMAGE_BINDING = 1;
+        static const uint32_t SAMPLER_BINDING = 2;
+
+        // Capacities are clamped to the device's update-after-bind descriptor limits
+        BindlessTable(VulkanContext& ctx, uint32_t buffer_capacity = 1024, uint32_t image_capacity = 4096);
+        ~BindlessTable();
+
+        VkDescriptorSetLayout getLayout();
+        VkDescriptorSet getSet();
+
+        // Return the array index to pass to shaders, UINT32_MAX when full
+        uint32_t addStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+        uint32_t addSampledImage(VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        // The slot is reused by the next add, the caller makes sure no
+        // frame in flight still reads it
+        void removeStorageBuffer(uint32_t index);
+        void removeSampledImage(uint32_t index);
+};
+
+#endif //BINDLESS_TABLE_H
@@ -3,6 +3,10 @@
 
 #include <vk_mem_alloc.h>
 
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
 #include "video/renderer_struct.h"
 
 enum BufferType
@@ -11,6 +15,21 @@ enum BufferType
     StagingBuffer,
     VertexBuffer,
     IndiceBuffer,
+    ReadbackBuffer,
+    StorageBuffer,
+    IndirectBuffer,
+    InstanceBuffer,
+};
+
+const uint32_t BUFFER_TYPE_COUNT = InstanceBuffer + 1;
+const char* buffer_type_name(BufferType type);
+
+// Buffers of one type, the ones alive and every one created since startup
+struct BufferTypeStats {
+    uint32_t live_count = 0;
+    VkDeviceSize live_bytes = 0;
+    VkDeviceSize peak_bytes = 0;
+    uint64_t created_count = 0;
 };
 
 class Buffer
@@ -19,22 +38,39 @@ class Buffer
         BufferType m_bufferType;
 
         size_t m_size;
+        size_t m_element_size;
         uint32_t m_number_elements;
         VkBuffer m_buffer;
         VmaAllocation m_allocation;
         VmaAllocationInfo m_allocation_info;
-        
+
+        static std::vector<uint32_t> s_shared_queue_families;
+
+        // Every buffer alive, counted per type. Buffers are created and
+        // destroyed from several threads
+        static std::mutex s_live_mutex;
+        static std::unordered_set<const Buffer*> s_live_buffers;
+        static BufferTypeStats s_type_stats[BUFFER_TYPE_COUNT];
 
     public:
         Buffer(BufferType type, uint32_t nb_elements, size_t size);
         ~Buffer();
 
+        BufferType getType();
         size_t getSize();
         VkBuffer& getBuffer();
         uint32_t getNumberOfElements();
+        // Index buffers: 32 bit for 4 byte elements, 16 bit otherwise
+        VkIndexType getIndexType();
         bool copyToStagingBuffer(const void* buffer, size_t size, VkDeviceSize offset=0);
-        static bool copyTo(VulkanContext& ctx, Buffer& src, Buffer& dst);
+        bool copyFromReadbackBuffer(void* buffer, size_t size, VkDeviceSize offset=0);
+        // GPU buffers filled by transfers are shared concurrently between these
+        // families, so uploads on a dedicated transfer queue need no ownership transfer
+        static void setSharedQueueFamilies(const std::vector<uint32_t>& families);
 
+        static BufferTypeStats getTypeStats(BufferType type);
+        // Logs a warning per buffer still alive and returns how many there are
+        static uint32_t logLiveBuffers();
 
 };
 
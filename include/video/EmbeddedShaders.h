@@ -0,0 +1,17 @@
+#ifndef EMBEDDED_SHADERS_H
+#define EMBEDDED_SHADERS_H
+
+#include <cstddef>
+
+// SPIR-V compiled into the binary by cmake/embed_shaders.cmake when
+// RENDERER_EMBED_SHADERS is defined. The table ends with a null entry.
+struct EmbeddedShader {
+    const char* name;
+    const unsigned char* code;
+    size_t size;
+};
+
+extern const EmbeddedShader EMBEDDED_SHADERS[];
+extern const size_t EMBEDDED_SHADER_COUNT;
+
+#endif //EMBEDDED_SHADERS_H
@@ -0,0 +1,72 @@
+#ifndef GPU_CULLING_H
+#define GPU_CULLING_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "video/renderer_struct.h"
+#include "video/Buffer.h"
+#include "video/UploadManager.h"
+
+class ShaderLibrary;
+
+// Per-object data read by the culling pass and the indirect vertex shader
+struct GpuObject {
+    glm::mat4 model;
+    // Bounding sphere in model space, xyz center and w radius
+    glm::vec4 bounds;
+};
+
+// GPU-driven drawing of up to max_objects instances of the mesh. A compute
+// pass tests every object's bounding sphere against the camera frustum and
+// appends a VkDrawIndexedIndirectCommand per visible object, consumed by a
+// single vkCmdDrawIndexedIndirectCount. Each frame in flight has its own
+// slice of the draw and count buffers and its own descriptor set, so frames
+// never wait on each other.
+class GpuCulling
+{
+    private:
+        VulkanContext& m_ctx;
+        uint32_t m_max_objects;
+        uint32_t m_frame_count;
+        uint32_t m_object_count = 0;
+
+        Buffer* m_objects = nullptr;
+        Buffer* m_draws = nullptr;
+        Buffer* m_counts = nullptr;
+
+        VkDescriptorSetLayout m_set_layout = VK_NULL_HANDLE;
+        VkDescriptorPool m_pool = VK_NULL_HANDLE;
+        std::vector<VkDescriptorSet> m_sets;
+        // Sets still pointing at a replaced object buffer
+        std::vector<bool> m_dirty;
+
+        VkPipelineLayout m_compute_layout = VK_NULL_HANDLE;
+        VkPipeline m_compute_pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout m_draw_layout = VK_NULL_HANDLE;
+
+        void writeSet(uint32_t frame);
+
+    public:
+        // frame_layout is set 0 of the draw pipeline layout, the culling set is set 1.
+        // Throws std::runtime_error on failure
+        GpuCulling(VulkanContext& ctx, ShaderLibrary& shaders, VkPipelineCache cache,
+                   VkDescriptorSetLayout frame_layout, uint32_t max_objects, uint32_t frame_count);
+        ~GpuCulling();
+
+        VkPipelineLayout getDrawLayout();
+        uint32_t getObjectCount();
+
+        // Uploads the objects into a new buffer. The replaced buffer is
+        // returned in retired, frames in flight may still read it
+        bool setObjects(UploadManager& uploads, const std::vector<GpuObject>& objects, Buffer*& retired, UploadTicket* ticket);
+
+        // Outside a render pass: clears the frame's count, culls and makes
+        // the draws visible to the indirect stage
+        void recordCull(VkCommandBuffer command_buffer, uint32_t frame, const glm::mat4& view_proj, uint32_t index_count);
+        // Inside the render pass, with the draw pipeline and mesh buffers bound
+        void recordDraw(VkCommandBuffer command_buffer, uint32_t frame);
+};
+
+#endif //GPU_CULLING_H
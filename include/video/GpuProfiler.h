@@ -0,0 +1,102 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "video/renderer_struct.h"
+
+// Index of a named scope, stays valid for the profiler's lifetime
+typedef uint32_t GpuScope;
+const GpuScope INVALID_GPU_SCOPE = UINT32_MAX;
+
+// GPU time of one scope, in milliseconds
+struct GpuScopeStats {
+    std::string name;
+    double last = 0.0;
+    // Over the last getWindow() frames the scope was recorded in
+    double average = 0.0;
+    double max = 0.0;
+    uint64_t samples = 0;
+};
+
+// Measures GPU time of render passes and user scopes with timestamp queries.
+// Each frame in flight owns a query pool. The timestamps a frame wrote are
+// read back when its slot is recorded again, after its fence signaled, so
+// reading never waits on the GPU. Scopes nest and are written from the
+// primary command buffer, outside or around render passes.
+class GpuProfiler
+{
+    private:
+        struct Scope
+        {
+            GpuScopeStats stats;
+            // Ring of the last samples, averaged into stats.average
+            std::vector<double> history;
+            uint32_t next_sample = 0;
+        };
+
+        // A scope written into a frame's pool, its begin and end queries
+        struct Written
+        {
+            GpuScope scope;
+            uint32_t begin_query;
+            uint32_t end_query;
+        };
+
+        struct Frame
+        {
+            VkQueryPool pool = VK_NULL_HANDLE;
+            std::vector<Written> written;
+            uint32_t query_count = 0;
+        };
+
+        VulkanContext& m_ctx;
+        uint32_t m_max_queries;
+        uint32_t m_window;
+        // Nanoseconds per timestamp tick
+        double m_period;
+        uint64_t m_valid_mask;
+
+        std::vector<Frame> m_frames;
+        uint32_t m_current = 0;
+        // Indices into the current frame's written list of the open scopes
+        std::vector<uint32_t> m_open;
+
+        std::vector<Scope> m_scopes;
+        std::unordered_map<std::string, GpuScope> m_names;
+        std::vector<GpuScopeStats> m_stats;
+        std::vector<uint64_t> m_results;
+
+        void collect(Frame& frame);
+        void addSample(Scope& scope, double ms);
+
+    public:
+        // max_scopes scopes can be written per frame, averages run over window
+        // frames. Throws std::runtime_error if the graphics queue has no
+        // timestamps or a query pool cannot be created
+        GpuProfiler(VulkanContext& ctx, uint32_t frame_count, uint32_t max_scopes = 64, uint32_t window = 64);
+        ~GpuProfiler();
+
+        // Same name, same scope
+        GpuScope getScope(const std::string& name);
+
+        // First command of the frame's command buffer. The frame's fence must
+        // have signaled: reads back its previous timestamps, then resets them
+        void beginFrame(VkCommandBuffer command_buffer, uint32_t frame);
+        // Last command before the frame's command buffer ends, closes open scopes
+        void endFrame(VkCommandBuffer command_buffer);
+        // Scopes beyond max_scopes in a frame are dropped
+        void beginScope(VkCommandBuffer command_buffer, GpuScope scope);
+        void endScope(VkCommandBuffer command_buffer);
+
+        uint32_t getWindow() const;
+        // One entry per scope, in getScope order
+        const std::vector<GpuScopeStats>& getStats();
+        const GpuScopeStats& getScopeStats(GpuScope scope) const;
+        // Average frame time of the named scope, 0 if it was never recorded
+        double getAverage(const std::string& name);
+};
+
+#endif //GPU_PROFILER_H
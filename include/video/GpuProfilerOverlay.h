@@ -0,0 +1,11 @@
+#ifndef GPU_PROFILER_OVERLAY_H
+#define GPU_PROFILER_OVERLAY_H
+
+class GpuProfiler;
+
+// Dear ImGui window listing the profiler's scopes with their last, average
+// and max GPU time. Call between ImGui::NewFrame and ImGui::Render of an
+// application that drives ImGui, only built into targets that compile imgui
+void draw_gpu_profiler_overlay(GpuProfiler& profiler, bool* open = nullptr);
+
+#endif //GPU_PROFILER_OVERLAY_H
@@ -0,0 +1,17 @@
+#ifndef INDICES_H
+#define INDICES_H
+
+#include <cstdint>
+#include <vector>
+
+// Highest vertex a 16 bit index buffer can address
+const uint32_t MAX_INDEX_UINT16 = UINT16_MAX;
+
+// Largest index in the list, 0 when empty
+uint32_t max_index(const std::vector<uint32_t>& indices);
+
+// 16 bit copy of indices whose max_index is at most MAX_INDEX_UINT16.
+// Returns false and leaves narrowed empty when one does not fit
+bool narrow_indices(const std::vector<uint32_t>& indices, std::vector<uint16_t>& narrowed);
+
+#endif //INDICES_H
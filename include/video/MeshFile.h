@@ -0,0 +1,100 @@
+#ifndef MESH_FILE_H
+#define MESH_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// Binary mesh container, written by mesh_converter and read through a
+// MappedFile without parsing:
+//   MeshFileHeader
+//   MeshFileAttribute[attribute_count], the interleaved vertex layout
+//   vertex blob at vertex_offset, index blob at index_offset
+// Both blobs are MESH_FILE_ALIGNMENT aligned and already in the layout the
+// GPU reads, so loading is one copy from the mapping into staging.
+// Fields are little endian.
+const uint32_t MESH_FILE_MAGIC = 0x4853454d; // "MESH"
+const uint32_t MESH_FILE_VERSION = 1;
+const uint32_t MESH_FILE_ALIGNMENT = 16;
+const uint32_t MESH_FILE_MAX_ATTRIBUTES = 16;
+
+struct MeshFileHeader {
+    uint32_t magic = MESH_FILE_MAGIC;
+    uint32_t version = MESH_FILE_VERSION;
+    uint32_t vertex_stride = 0;
+    uint32_t attribute_count = 0;
+    uint32_t vertex_count = 0;
+    uint32_t index_count = 0;
+    // 2 or 4 bytes per index
+    uint32_t index_size = 0;
+    uint32_t reserved = 0;
+    uint64_t vertex_offset = 0;
+    uint64_t index_offset = 0;
+};
+
+static_assert(sizeof(MeshFileHeader) == 48, "MeshFileHeader is part of the file format");
+
+// Attribute at location i is the i-th entry
+struct MeshFileAttribute {
+    // VkFormat
+    uint32_t format = 0;
+    uint32_t offset = 0;
+};
+
+// Validated pointers into the bytes of a mesh file
+struct MeshFileView {
+    const MeshFileHeader* header = nullptr;
+    const MeshFileAttribute* attributes = nullptr;
+    const void* vertices = nullptr;
+    const void* indices = nullptr;
+
+    VkIndexType getIndexType() const;
+
+    // True if the vertices are laid out exactly like T's Format
+    template<typename T>
+    bool hasLayout() const
+    {
+        auto descriptions = T::Format::getAttributeDescriptions();
+        if (header->vertex_stride != T::Format::getStride() || header->attribute_count != descriptions.size())
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < header->attribute_count; i++)
+        {
+            if (attributes[i].format != static_cast<uint32_t>(descriptions[i].format) ||
+                attributes[i].offset != descriptions[i].offset)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Checks the header, that every blob lies inside the size bytes at data and
+// that every index is below vertex_count. 32 bit indices must also be at most
+// max_index_value, the device's maxDrawIndexedIndexValue. Returns true on failure
+bool read_mesh_file(const void* data, size_t size, MeshFileView& view, uint32_t max_index_value = UINT32_MAX);
+
+// Writes vertex_count interleaved vertices of the given layout and the
+// indices, narrowed to 16 bit when they fit. Returns true on failure
+bool write_mesh_file(const std::string& path, const std::vector<MeshFileAttribute>& attributes, uint32_t vertex_stride,
+                     const void* vertices, uint32_t vertex_count, const std::vector<uint32_t>& indices);
+
+template<typename T>
+bool write_mesh_file(const std::string& path, const std::vector<T>& vertices, const std::vector<uint32_t>& indices)
+{
+    std::vector<MeshFileAttribute> attributes;
+    for (const auto& description : T::Format::getAttributeDescriptions())
+    {
+        MeshFileAttribute attribute;
+        attribute.format = static_cast<uint32_t>(description.format);
+        attribute.offset = description.offset;
+        attributes.push_back(attribute);
+    }
+    return write_mesh_file(path, attributes, T::Format::getStride(), vertices.data(), static_cast<uint32_t>(vertices.size()), indices);
+}
+
+#endif //MESH_FILE_H
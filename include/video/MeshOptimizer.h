@@ -0,0 +1,39 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "video/Vertex.h"
+
+// CPU passes run on a mesh before upload, in the order optimize_mesh
+// applies them. They only reorder and merge, the mesh keeps the same
+// triangles. Indices are 32 bit here, the upload narrows them when possible.
+//
+// The pipeline has no depth test, so overlapping triangles of a mesh are
+// drawn in index order. Reordering triangles changes which one ends up on
+// top: only optimize meshes whose triangles do not overlap on screen.
+// There is no overdraw pass: vertices are 2D, every triangle faces the
+// same way and there is no occlusion order to sort by.
+
+// Merges bitwise identical vertices and rewrites indices to point at the
+// unique ones. Empty indices are treated as an unindexed triangle list
+void deduplicate_vertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// Reorders triangles so consecutive ones share vertices still in the
+// post-transform cache (Forsyth's linear-speed algorithm)
+void optimize_vertex_cache(std::vector<uint32_t>& indices, uint32_t vertex_count);
+
+// Reorders vertices by first use so fetches walk memory linearly, and
+// drops unreferenced ones. Returns the old to new index remap, UINT32_MAX
+// for dropped vertices, to reorder other per-vertex streams the same way
+std::vector<uint32_t> optimize_vertex_fetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// All of the above
+void optimize_mesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// Average cache miss ratio: transformed vertices per triangle with a FIFO
+// cache of cache_size entries. 3 is the worst case, around 0.6 is good
+float average_cache_miss_ratio(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size = 16);
+
+#endif //MESH_OPTIMIZER_H
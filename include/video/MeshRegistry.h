@@ -0,0 +1,88 @@
+#ifndef MESH_REGISTRY_H
+#define MESH_REGISTRY_H
+
+#include <vk_mem_alloc.h>
+
+#include <vector>
+
+#include "video/Buffer.h"
+#include "video/UploadManager.h"
+#include "video/Vertex.h"
+
+// Index of a registered mesh, reused once the mesh is removed
+typedef uint32_t MeshHandle;
+const MeshHandle INVALID_MESH = UINT32_MAX;
+
+// Where a mesh lives in the shared buffers, in vertices and indices
+struct MeshRange {
+    // Base vertex added to every index, so meshes keep 16 bit local indices
+    int32_t vertex_offset = 0;
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+    uint32_t vertex_count = 0;
+    // Selects the shared index buffer the mesh lives in
+    VkIndexType index_type = VK_INDEX_TYPE_UINT16;
+};
+
+// Sub-allocates many meshes out of one device-local vertex buffer and one
+// index buffer, tracked by VMA virtual blocks counted in vertices and
+// indices. Every mesh is drawn with the same two buffers bound, only the
+// draw's base vertex and first index change. Meshes with more than 65536
+// vertices go to a second, 32 bit index buffer created on first use.
+class MeshRegistry
+{
+    private:
+        struct Entry
+        {
+            MeshRange range;
+            VmaVirtualAllocation vertex_allocation = VK_NULL_HANDLE;
+            VmaVirtualAllocation index_allocation = VK_NULL_HANDLE;
+            bool live = false;
+        };
+
+        UploadManager& m_uploads;
+        uint32_t m_index_capacity;
+        size_t m_vertex_stride;
+        Buffer* m_vertices = nullptr;
+        Buffer* m_indices = nullptr;
+        Buffer* m_wide_indices = nullptr;
+        VmaVirtualBlock m_vertex_block = VK_NULL_HANDLE;
+        VmaVirtualBlock m_index_block = VK_NULL_HANDLE;
+        VmaVirtualBlock m_wide_index_block = VK_NULL_HANDLE;
+
+        std::vector<Entry> m_entries;
+        std::vector<MeshHandle> m_free_handles;
+        uint32_t m_mesh_count = 0;
+
+        MeshHandle addMesh(const void* vertices, uint32_t vertex_count, const void* indices, uint32_t index_count,
+                           VkIndexType index_type, UploadTicket* ticket);
+        VmaVirtualBlock getIndexBlock(VkIndexType index_type);
+
+    public:
+        // Throws std::runtime_error on failure
+        // vertex_stride is the size of one vertex of the format every mesh shares
+        MeshRegistry(UploadManager& uploads, uint32_t vertex_capacity, uint32_t index_capacity, size_t vertex_stride = sizeof(Vertex));
+        ~MeshRegistry();
+
+        // Uploads the mesh into free ranges of the shared buffers, returns
+        // INVALID_MESH when either buffer has no room left. vertices holds
+        // vertex_count vertices of the registry's stride
+        MeshHandle add(const void* vertices, uint32_t vertex_count, const std::vector<uint16_t>& indices, UploadTicket* ticket = nullptr);
+        // Narrowed to 16 bit when every index fits
+        MeshHandle add(const void* vertices, uint32_t vertex_count, const std::vector<uint32_t>& indices, UploadTicket* ticket = nullptr);
+        // index_count indices of index_type, copied as they are
+        MeshHandle add(const void* vertices, uint32_t vertex_count, const void* indices, uint32_t index_count,
+                       VkIndexType index_type, UploadTicket* ticket = nullptr);
+        // The ranges are reused by the next add, the caller makes sure no
+        // frame in flight still draws the mesh
+        void remove(MeshHandle mesh);
+
+        bool isValid(MeshHandle mesh);
+        const MeshRange& getRange(MeshHandle mesh);
+        uint32_t getMeshCount();
+        VkBuffer& getVertexBuffer();
+        // VK_NULL_HANDLE for 32 bit until a wide mesh was added
+        VkBuffer getIndexBuffer(VkIndexType index_type);
+};
+
+#endif //MESH_REGISTRY_H
@@ -0,0 +1,18 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "video/Vertex.h"
+
+// Reads the positions and faces of a Wavefront OBJ file. Vertex only has a
+// 2D position and a color: x and y become the position, the optional
+// "v x y z r g b" color extension the color (white without it). Texture
+// coordinates, normals, groups and materials are ignored, faces with more
+// than three corners are triangulated as fans.
+// Returns true on failure
+bool load_obj(const std::string& path, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+#endif //OBJ_LOADER_H
@@ -0,0 +1,34 @@
+#ifndef PIPELINE_CACHE_H
+#define PIPELINE_CACHE_H
+
+#include <string>
+#include <vector>
+
+#include "video/renderer_struct.h"
+
+// VkPipelineCache persisted to disk between runs. The blob is only reused
+// when its header matches the current driver (vendor, device and cache
+// UUID), otherwise the cache starts empty and is overwritten on save.
+class PipelineCache
+{
+    private:
+        VulkanContext& m_ctx;
+        std::string m_path;
+        VkPipelineCache m_cache = VK_NULL_HANDLE;
+        bool m_loaded = false;
+
+        bool isCompatible(const std::vector<char>& blob);
+
+    public:
+        // An empty path keeps the cache in memory only
+        PipelineCache(VulkanContext& ctx, const std::string& path);
+        ~PipelineCache();
+
+        VkPipelineCache get();
+        // True when a compatible blob was read from disk
+        bool isLoaded();
+        // Writes the cache blob next to the path and renames it over the old one
+        bool save();
+};
+
+#endif //PIPELINE_CACHE_H
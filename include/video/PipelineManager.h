@@ -0,0 +1,130 @@
+#ifndef PIPELINE_MANAGER_H
+#define PIPELINE_MANAGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "video/renderer_struct.h"
+
+class JobSystem;
+class ShaderLibrary;
+
+// Index of a requested pipeline, stays valid for the manager's lifetime
+typedef uint32_t PipelineHandle;
+const PipelineHandle INVALID_PIPELINE = UINT32_MAX;
+
+// Vertex formats a pipeline can consume, each maps to fixed binding and
+// attribute descriptions
+enum class VertexLayout : uint8_t {
+    PositionColor,          // Vertex
+    PositionColorInstanced, // Vertex, then Instance on binding 1
+    Compact,                // CompactVertex
+    CompactInstanced,       // CompactVertex, then Instance on binding 1
+};
+
+// Everything that distinguishes one graphics pipeline from another.
+// Viewport and scissor are dynamic, so they are not part of the key.
+struct PipelineKey {
+    // Shader names resolved through the ShaderLibrary
+    std::string vertex_shader = "triangle.vert.spv";
+    std::string fragment_shader = "triangle.frag.spv";
+    VertexLayout vertex_layout = VertexLayout::PositionColor;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode polygon_mode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cull_mode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace front_face = VK_FRONT_FACE_CLOCKWISE;
+    bool blend_enable = false;
+    VkRenderPass render_pass = VK_NULL_HANDLE;
+    VkFormat color_format = VK_FORMAT_UNDEFINED;
+    uint32_t subpass = 0;
+    // VK_NULL_HANDLE uses the manager's default layout
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+
+    bool operator==(const PipelineKey& other) const;
+};
+
+struct PipelineKeyHash {
+    size_t operator()(const PipelineKey& key) const;
+};
+
+// Creates graphics pipelines on demand and returns the existing one when
+// an identical key is requested again. Owns every pipeline it created.
+// With a JobSystem, pipelines compile on its workers and request() returns
+// immediately, the frame loop polls tryGet() and never blocks on a compile.
+// Pipelines rebuilt after a shader change are swapped in by
+// applyRebuilds(), which must run on the thread calling tryGet().
+class PipelineManager
+{
+    private:
+        enum State : int { Pending, Ready, Failed };
+
+        struct Entry
+        {
+            PipelineKey key;
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            // Published with release ordering once pipeline is written
+            std::atomic<int> state{ Pending };
+
+            // Rebuild compiled in the background, swapped in by applyRebuilds
+            VkPipeline replacement = VK_NULL_HANDLE;
+            std::atomic<bool> rebuilt{ false };
+            // Guarded by m_mutex
+            bool rebuilding = false;
+            bool rebuild_again = false;
+        };
+
+        VulkanContext& m_ctx;
+        VkPipelineCache m_cache;
+        VkPipelineLayout m_layout;
+        ShaderLibrary& m_shaders;
+        JobSystem* m_jobs;
+
+        std::mutex m_mutex;
+        std::condition_variable m_compiled;
+        // Deque so entries never move while workers compile into them
+        std::deque<Entry> m_entries;
+        std::unordered_map<PipelineKey, PipelineHandle, PipelineKeyHash> m_handles;
+        uint32_t m_pending = 0;
+        uint32_t m_rebuilding = 0;
+
+        VkPipeline createPipeline(const PipelineKey& key);
+        void compile(PipelineHandle handle);
+        void compileReplacement(PipelineHandle handle);
+        // Called with m_mutex held
+        void queueRebuild(PipelineHandle handle);
+
+    public:
+        // jobs may be nullptr, pipelines are then compiled inside request()
+        PipelineManager(VulkanContext& ctx, VkPipelineCache cache, VkPipelineLayout layout, ShaderLibrary& shaders, JobSystem* jobs = nullptr);
+        ~PipelineManager();
+
+        // Queues the pipeline for compilation unless an identical key was requested before
+        PipelineHandle request(const PipelineKey& key);
+        // The pipeline if it is compiled, otherwise the fallback's if that one
+        // is, otherwise VK_NULL_HANDLE
+        VkPipeline tryGet(PipelineHandle handle, PipelineHandle fallback = INVALID_PIPELINE);
+        bool isReady(PipelineHandle handle);
+        bool hasFailed(PipelineHandle handle);
+        // Blocks until the pipeline is compiled, returns VK_NULL_HANDLE if it failed
+        VkPipeline wait(PipelineHandle handle);
+        // Blocks until every requested pipeline is compiled
+        void waitIdle();
+        // Blocking request, returns VK_NULL_HANDLE if the pipeline could not be created
+        VkPipeline get(const PipelineKey& key);
+        size_t getPipelineCount();
+
+        // Recompiles every compiled or failed pipeline using the shader,
+        // the current pipelines stay in use until applyRebuilds
+        void rebuild(const std::string& shader_name);
+        // Swaps in the rebuilt pipelines and appends the ones they replace
+        // to retired, which the caller destroys once no frame uses them
+        void applyRebuilds(std::vector<VkPipeline>& retired);
+};
+
+#endif //PIPELINE_MANAGER_H
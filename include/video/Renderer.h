@@ -7,13 +7,65 @@
 
 #include <vk_mem_alloc.h>
 
+#include <string>
 #include <vector>
 
 #include "video/renderer_struct.h"
 #include "video/render_data.h"
 #include "video/Vertex.h"
 #include "video/Buffer.h"
+#include "video/UploadManager.h"
 #include "video/UniformBuffer.h"
+#include "video/BindlessTable.h"
+#include "video/AssetStreamer.h"
+#include "video/GpuCulling.h"
+#include "video/GpuProfiler.h"
+#include "video/MeshRegistry.h"
+#include "video/VmaUsage.h"
+
+struct RendererConfig {
+    uint32_t width = 800;
+    uint32_t height = 600;
+    // Render into offscreen images instead of an SDL window / swapchain
+    bool headless = false;
+    uint32_t frames_in_flight = 4;
+    // Worker threads recording draws into secondary command buffers, 0 records inline
+    uint32_t recording_threads = 0;
+    // Uniforms that can be pushed per frame, sizes the uniform ring
+    uint32_t max_draws_per_frame = 4096;
+    // Vertices and 16 bit indices shared by all the meshes created with createMesh
+    uint32_t mesh_vertex_capacity = 1 << 18;
+    uint32_t mesh_index_capacity = 1 << 20;
+    // Run optimize_mesh on meshes given to createMesh before uploading them.
+    // Triangles are reordered, overlapping ones may change stacking order
+    bool optimize_meshes = false;
+    // Quantize vertices to CompactVertex (half positions, unorm8 colors)
+    // before uploading them, halving vertex memory and fetch bandwidth
+    bool compact_vertices = false;
+    // Workers loading meshes requested with streamMesh, 0 disables streaming
+    uint32_t streaming_threads = 0;
+    // Bytes of streamed meshes uploaded per frame, at least one mesh always goes
+    uint32_t stream_budget_bytes = 8 << 20;
+    // Instances that can be drawn per frame with drawInstanced, 0 disables instancing
+    uint32_t max_instances_per_frame = 0;
+    // Pipeline cache blob loaded at init and written back on shutdown, empty disables it
+    std::string pipeline_cache_path;
+    // Threads compiling pipelines in the background, 0 compiles them during init.
+    // Draws whose pipeline is still compiling are skipped
+    uint32_t pipeline_compile_threads = 1;
+    // Watch the shader folder and rebuild pipelines whose SPIR-V changed
+    bool hot_reload_shaders = false;
+    // Bind every resource through one descriptor indexing set, draws only
+    // push indices. Requires Vulkan 1.2 descriptor indexing features
+    bool bindless = false;
+    // Cull objects set with setObjects in a compute pass and draw the
+    // visible ones with one indirect count draw. Not combined with bindless
+    bool gpu_culling = false;
+    uint32_t max_objects = 100000;
+    // Time the frame, culling and main pass on the GPU with timestamp queries,
+    // read through getGpuProfiler
+    bool gpu_profiling = false;
+};
 
 class Renderer
 {
@@ -25,15 +77,70 @@ class Renderer
         Renderer(/* args */);
         ~Renderer();
         bool init(uint32_t width, uint32_t height);
+        bool init(const RendererConfig& config);
         bool drawFrame();
         bool resize();
 
-        bool createVertexBuffer(const std::vector<Vertex>& vertices);
-        bool createIndicesBuffer(const std::vector<uint16_t>& indices);
+        // Headless only: copy the last drawn frame as tightly packed RGBA8
+        bool readFrame(std::vector<uint8_t>& pixels);
+        bool waitIdle();
+        const FrameTimings& getLastFrameTimings() const;
+        const InitTimings& getInitTimings() const;
+        // nullptr unless RendererConfig::bindless is set
+        BindlessTable* getBindlessTable();
+        // nullptr unless RendererConfig::gpu_profiling is set and the device has timestamps
+        GpuProfiler* getGpuProfiler();
+        // Budget and usage of each memory heap, refreshed every frame
+        const std::vector<HeapBudget>& getMemoryBudgets() const;
+        // Heap budgets, live and peak buffers per BufferType, and the
+        // allocator's vmaBuildStatsString as one JSON document. Detailed
+        // lists every allocation
+        bool writeMemoryStats(const std::string& path, bool detailed = false);
+        bool arePipelinesReady();
+        // Blocks until every pipeline requested so far has compiled
+        void waitForPipelines();
+
+        // Uploads are asynchronous: frames drawn afterwards wait for them on the GPU,
+        // the optional ticket lets the caller wait on the CPU
+        bool createVertexBuffer(const std::vector<Vertex>& vertices, UploadTicket* ticket = nullptr);
+        bool createIndicesBuffer(const std::vector<uint16_t>& indices, UploadTicket* ticket = nullptr);
+        // Stored as 16 bit when every index fits, 32 bit otherwise
+        bool createIndicesBuffer(const std::vector<uint32_t>& indices, UploadTicket* ticket = nullptr);
+        // Registers a mesh in the shared vertex and index buffers
+        bool createMesh(const std::vector<Vertex>& vertices, const std::vector<uint16_t>& indices, MeshHandle& mesh, UploadTicket* ticket = nullptr);
+        bool createMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, MeshHandle& mesh, UploadTicket* ticket = nullptr);
+        // Registers the mesh of a binary mesh file, see MeshFile.h. Copied
+        // from the file mapping into staging when its layout matches
+        bool loadMesh(const std::string& path, MeshHandle& mesh, UploadTicket* ticket = nullptr);
+        // The mesh is released once the frames in flight are done with it
+        void destroyMesh(MeshHandle mesh);
+        // Loads an OBJ file into a mesh in the background, drawFrame uploads
+        // it once decoded. INVALID_STREAM_REQUEST when streaming is disabled
+        StreamRequest streamMesh(const std::string& path);
+        StreamState getStreamState(StreamRequest request);
+        // The mesh of a Ready request, destroyed with destroyMesh
+        MeshHandle getStreamedMesh(StreamRequest request);
+        bool isUploadComplete(UploadTicket ticket);
+        bool waitForUpload(UploadTicket ticket);
         bool createUniformBuffers(size_t buffer_size);
+        // Sets the uniform used when no draw is queued with drawMesh
         bool updateUniformBuffer(const UniformBufferObject& ubo);
-
-        bool recordCommandBuffer();
+        // Copies ubo into this frame's slice of the uniform ring and returns
+        // the aligned dynamic offset to draw with
+        bool pushUniform(const UniformBufferObject& ubo, uint32_t& offset);
+        // Queues a draw of the mesh for the next drawFrame using the uniform at uniform_offset
+        void drawMesh(uint32_t uniform_offset);
+        // Queues a draw of a mesh created with createMesh
+        void drawMesh(MeshHandle mesh, uint32_t uniform_offset);
+        // Queues one draw of instance_count copies of the mesh, each with its own
+        // transform and color applied after the uniform's view and projection.
+        // The instances are copied, the array can be reused right away
+        bool drawInstanced(const Instance* instances, uint32_t instance_count, uint32_t uniform_offset);
+        // Number of times the mesh is drawn per frame when no draw is queued with drawMesh or drawInstanced
+        void setDrawCount(uint32_t draw_count);
+        // GPU culling only: instances of the mesh culled against the camera of
+        // the default uniform. While there are objects they replace the other draws
+        bool setObjects(const std::vector<GpuObject>& objects, UploadTicket* ticket = nullptr);
 
 };
 
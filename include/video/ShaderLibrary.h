@@ -0,0 +1,41 @@
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "video/renderer_struct.h"
+
+// Shader modules shared by every pipeline, keyed by a hash of their SPIR-V
+// so identical binaries create a single VkShaderModule. Binaries embedded
+// at build time are used first, otherwise the file is mapped from the
+// shader folder. Safe to call from pipeline compile workers.
+class ShaderLibrary
+{
+    private:
+        VulkanContext& m_ctx;
+        std::string m_folder;
+
+        std::mutex m_mutex;
+        std::unordered_map<uint64_t, VkShaderModule> m_modules;
+        // Name to content hash of the binary last loaded under that name
+        std::unordered_map<std::string, uint64_t> m_names;
+
+        VkShaderModule createModule(const void* code, size_t size, uint64_t& hash);
+
+    public:
+        ShaderLibrary(VulkanContext& ctx, const std::string& folder);
+        ~ShaderLibrary();
+
+        // Returns VK_NULL_HANDLE if the shader cannot be found or is not valid SPIR-V
+        VkShaderModule getModule(const std::string& name);
+        // Reads the shader from the folder again, even if it was embedded.
+        // Returns true if its content changed and it is valid SPIR-V
+        bool reload(const std::string& name);
+        size_t getModuleCount();
+
+        static uint64_t hash(const void* data, size_t size);
+};
+
+#endif //SHADER_LIBRARY_H
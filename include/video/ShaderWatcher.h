@@ -0,0 +1,24 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <string>
+#include <vector>
+
+// Watches the shader folder for SPIR-V files being rewritten, either in
+// place or renamed over the old file. Uses inotify, so it is Linux only.
+class ShaderWatcher
+{
+    private:
+        int m_fd = -1;
+        int m_watch = -1;
+
+    public:
+        // Throws std::runtime_error if the folder cannot be watched
+        ShaderWatcher(const std::string& folder);
+        ~ShaderWatcher();
+
+        // Names of the .spv files changed since the last call, never blocks
+        std::vector<std::string> poll();
+};
+
+#endif //SHADER_WATCHER_H
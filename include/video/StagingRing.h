@@ -0,0 +1,42 @@
+#ifndef STAGING_RING_H
+#define STAGING_RING_H
+
+#include <deque>
+
+#include "video/Buffer.h"
+
+// Persistently mapped staging buffer handed out with a bump pointer.
+// Regions are tagged with the upload ticket that reads them and are
+// recycled in order once that ticket has completed.
+class StagingRing
+{
+    private:
+        struct Region
+        {
+            VkDeviceSize end;
+            uint64_t ticket;
+        };
+
+        Buffer* m_buffer;
+        VkDeviceSize m_capacity;
+        VkDeviceSize m_head = 0;
+        VkDeviceSize m_tail = 0;
+        std::deque<Region> m_regions;
+
+    public:
+        StagingRing(VkDeviceSize capacity);
+        ~StagingRing();
+
+        Buffer& getBuffer();
+        VkDeviceSize getCapacity();
+
+        // Reserves size bytes that stay valid until ticket completes, false when full
+        bool allocate(VkDeviceSize size, VkDeviceSize alignment, uint64_t ticket, VkDeviceSize& offset);
+        // Recycles every region whose ticket is <= completed
+        void retire(uint64_t completed);
+        // Replaces the buffer with a larger empty one and returns the old buffer,
+        // which the caller must keep alive until its pending copies complete
+        Buffer* grow(VkDeviceSize capacity);
+};
+
+#endif //STAGING_RING_H
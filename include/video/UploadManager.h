@@ -0,0 +1,69 @@
+#ifndef UPLOAD_MANAGER_H
+#define UPLOAD_MANAGER_H
+
+#include <vector>
+
+#include "video/renderer_struct.h"
+#include "video/Buffer.h"
+#include "video/StagingRing.h"
+
+// Timeline value signaled once the batch holding an upload has executed
+typedef uint64_t UploadTicket;
+
+// Batches buffer copies into a ring of command buffers submitted to a
+// dedicated transfer queue (or the graphics queue when there is none).
+// Every batch signals the next value of a timeline semaphore.
+class UploadManager
+{
+    private:
+        struct Batch
+        {
+            VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+            uint64_t value = 0;
+            std::vector<Buffer*> released_buffers;
+        };
+
+        VulkanContext& m_ctx;
+        VkQueue m_queue;
+        uint32_t m_queue_family;
+        bool m_dedicated;
+        VkCommandPool m_command_pool;
+        VkSemaphore m_timeline;
+        StagingRing* m_staging;
+
+        std::vector<Batch> m_batches;
+        uint32_t m_current = 0;
+        bool m_recording = false;
+        uint64_t m_submitted_value = 0;
+
+        bool beginBatch();
+        void releaseBatch(Batch& batch);
+
+    public:
+        UploadManager(VulkanContext& ctx, VkDeviceSize staging_size, uint32_t ring_size = 8);
+        ~UploadManager();
+
+        bool isDedicated();
+        uint32_t getQueueFamily();
+        VkSemaphore getSemaphore();
+        // Ticket of the last submitted batch, 0 when nothing was submitted
+        UploadTicket getSubmittedTicket();
+
+        // Copies content into the staging ring and records its upload to dst,
+        // returns the ticket of the open batch or 0 on failure
+        UploadTicket upload(const void* content, VkDeviceSize size, VkBuffer dst, VkDeviceSize dst_offset = 0);
+        // Records a copy into the open batch and returns the ticket of that batch
+        UploadTicket enqueueCopy(VkBuffer src, VkBuffer dst, const VkBufferCopy& region);
+        // Deletes the buffer once the open batch has executed
+        void releaseAfterUpload(Buffer* buffer);
+        // Submits the open batch, does nothing if no copy was recorded
+        bool flush();
+
+        bool isComplete(UploadTicket ticket);
+        // Flushes if needed and blocks until the ticket's batch has executed
+        bool wait(UploadTicket ticket);
+        // Frees buffers and staging regions released by batches that have executed
+        void collect();
+};
+
+#endif //UPLOAD_MANAGER_H
@@ -2,35 +2,68 @@
 #define VERTEX_H
 
 #include <array>
+#include <cstddef>
 #include <glm/glm.hpp>
 #include <vulkan/vulkan_core.h>
 
+#include "video/VertexFormat.h"
+
 struct Vertex {
     glm::vec2 pos;
     glm::vec3 color;
 
+    typedef VertexFormat<Float2, Float3> Format;
+
+    static VkVertexInputBindingDescription getBindingDescription() {
+        return Format::getBindingDescription();
+    }
+
+    static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions() {
+        return Format::getAttributeDescriptions();
+    }
+};
+
+static_assert(sizeof(Vertex) == Vertex::Format::getStride(), "Vertex does not match its format");
+static_assert(offsetof(Vertex, color) == Vertex::Format::getOffset(1), "Vertex does not match its format");
+
+// Vertex quantized to 8 bytes instead of 20: half float position and 8 bit
+// color. Read by the same shaders as Vertex, alpha is ignored
+struct CompactVertex {
+    uint16_t pos[2];
+    uint8_t color[4];
+
+    typedef VertexFormat<Half2, Unorm8x4> Format;
+
     static VkVertexInputBindingDescription getBindingDescription() {
-        VkVertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-        return bindingDescription;
+        return Format::getBindingDescription();
     }
 
     static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions() {
-        std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, pos);
-    
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(Vertex, color);
-    
-        return attributeDescriptions;
+        return Format::getAttributeDescriptions();
     }
 };
 
-#endif //VERTEX_H
\ No newline at end of file
+static_assert(sizeof(CompactVertex) == CompactVertex::Format::getStride(), "CompactVertex does not match its format");
+static_assert(offsetof(CompactVertex, color) == CompactVertex::Format::getOffset(1), "CompactVertex does not match its format");
+
+// Per-instance stream on binding 1, advanced once per instance
+struct Instance {
+    glm::mat4 transform;
+    glm::vec4 color;
+
+    // A mat4 takes one location per column
+    typedef VertexFormat<Float4, Float4, Float4, Float4, Float4> Format;
+
+    static VkVertexInputBindingDescription getBindingDescription() {
+        return Format::getBindingDescription(1, VK_VERTEX_INPUT_RATE_INSTANCE);
+    }
+
+    // Locations follow the vertex attributes
+    static std::array<VkVertexInputAttributeDescription, 5> getAttributeDescriptions() {
+        return Format::getAttributeDescriptions(1, 2);
+    }
+};
+
+static_assert(sizeof(Instance) == Instance::Format::getStride(), "Instance does not match its format");
+
+#endif //VERTEX_H
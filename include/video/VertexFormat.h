@@ -0,0 +1,99 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <array>
+#include <cstdint>
+#include <vulkan/vulkan_core.h>
+
+// Attribute types of a VertexFormat: the format the shader reads and the
+// bytes it takes in the vertex. Quantized ones are expanded to floats by
+// the vertex fetch, shaders keep declaring vec2 / vec3 / vec4 inputs.
+struct Float2 {
+    static constexpr VkFormat format = VK_FORMAT_R32G32_SFLOAT;
+    static constexpr uint32_t size = 8;
+};
+
+struct Float3 {
+    static constexpr VkFormat format = VK_FORMAT_R32G32B32_SFLOAT;
+    static constexpr uint32_t size = 12;
+};
+
+struct Float4 {
+    static constexpr VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    static constexpr uint32_t size = 16;
+};
+
+struct Half2 {
+    static constexpr VkFormat format = VK_FORMAT_R16G16_SFLOAT;
+    static constexpr uint32_t size = 4;
+};
+
+struct Half4 {
+    static constexpr VkFormat format = VK_FORMAT_R16G16B16A16_SFLOAT;
+    static constexpr uint32_t size = 8;
+};
+
+// Colors in [0, 1]
+struct Unorm8x4 {
+    static constexpr VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+    static constexpr uint32_t size = 4;
+};
+
+// Unit vector folded onto an octahedron, decoded in the shader
+struct OctahedralNormal {
+    static constexpr VkFormat format = VK_FORMAT_R16G16_SNORM;
+    static constexpr uint32_t size = 4;
+};
+
+// Tightly packed interleaved vertex made of Attributes in order. Generates
+// the binding and attribute descriptions a pipeline needs, locations are
+// consecutive from first_location.
+template <typename... Attributes>
+struct VertexFormat {
+    static constexpr uint32_t getAttributeCount()
+    {
+        return sizeof...(Attributes);
+    }
+
+    // Byte offset of the attribute at position index, the stride for getAttributeCount()
+    static constexpr uint32_t getOffset(uint32_t index)
+    {
+        const uint32_t sizes[] = { Attributes::size... };
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i < index; i++)
+        {
+            offset += sizes[i];
+        }
+        return offset;
+    }
+
+    static constexpr uint32_t getStride()
+    {
+        return getOffset(sizeof...(Attributes));
+    }
+
+    static VkVertexInputBindingDescription getBindingDescription(uint32_t binding = 0, VkVertexInputRate input_rate = VK_VERTEX_INPUT_RATE_VERTEX)
+    {
+        VkVertexInputBindingDescription binding_description{};
+        binding_description.binding = binding;
+        binding_description.stride = getStride();
+        binding_description.inputRate = input_rate;
+        return binding_description;
+    }
+
+    static std::array<VkVertexInputAttributeDescription, sizeof...(Attributes)> getAttributeDescriptions(uint32_t binding = 0, uint32_t first_location = 0)
+    {
+        const VkFormat formats[] = { Attributes::format... };
+        std::array<VkVertexInputAttributeDescription, sizeof...(Attributes)> attribute_descriptions{};
+        for (uint32_t i = 0; i < sizeof...(Attributes); i++)
+        {
+            attribute_descriptions[i].binding = binding;
+            attribute_descriptions[i].location = first_location + i;
+            attribute_descriptions[i].format = formats[i];
+            attribute_descriptions[i].offset = getOffset(i);
+        }
+        return attribute_descriptions;
+    }
+};
+
+#endif //VERTEX_FORMAT_H
@@ -0,0 +1,26 @@
+#ifndef VERTEX_QUANTIZE_H
+#define VERTEX_QUANTIZE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "video/Vertex.h"
+
+// Encoders from float input to the quantized attribute types of
+// VertexFormat.h. Batches go through F16C / SSE2 when the compiler targets
+// them and fall back to scalar code otherwise, both round to nearest even.
+
+// IEEE half floats, out of range values become infinity
+void encode_half(const float* input, uint16_t* output, size_t count);
+
+// Values clamped to [0, 1] and scaled to [0, 255]
+void encode_unorm8(const float* input, uint8_t* output, size_t count);
+
+// count unit normals as xyz triplets into two snorm16 each, see OctahedralNormal
+void encode_octahedral(const float* normals, int16_t* output, size_t count);
+
+// Vertex to CompactVertex, color alpha set to 1
+void quantize_vertices(const std::vector<Vertex>& vertices, std::vector<CompactVertex>& compact);
+
+#endif //VERTEX_QUANTIZE_H
@@ -2,11 +2,37 @@
 #define VMA_USAGE_H
 
 #include <vk_mem_alloc.h>
+
+#include <string>
+#include <vector>
+
 #include "video/renderer_struct.h"
 
+// One memory heap, in bytes. Budget and usage come from the driver when
+// VK_EXT_memory_budget is enabled and are VMA's estimates otherwise
+struct HeapBudget {
+    // What the process can allocate from the heap before it starts paging
+    // or failing, shared with the other processes on the device
+    VkDeviceSize budget = 0;
+    // Used by the whole process with the extension, only VMA's blocks without
+    VkDeviceSize usage = 0;
+    // VkDeviceMemory blocks allocated by VMA, and the part of them in use
+    VkDeviceSize block_bytes = 0;
+    VkDeviceSize allocation_bytes = 0;
+    uint32_t allocation_count = 0;
+    bool device_local = false;
+};
+
 bool createAllocator(VulkanContext ctx);
 VmaAllocator& getAllocator();
 bool destroyAllocator();
+// Advances the allocator's frame index, which refreshes the budgets from the
+// driver, and reads them back. One entry per memory heap
+void updateAllocatorBudgets(uint64_t frame_number, std::vector<HeapBudget>& budgets);
+// Allocations of any kind still alive
+uint32_t getAllocationCount();
+// vmaBuildStatsString, a JSON document. Detailed also lists every allocation
+std::string buildAllocatorStatsString(bool detailed);
 
 #endif //VMA_USAGE_H
 
@@ -2,33 +2,179 @@
 #define RENDER_DATA_H
 
 #include <vector>
+#include <glm/glm.hpp>
 #include "video/Buffer.h"
+#include "video/MeshRegistry.h"
+#include "video/VmaUsage.h"
+
+class JobSystem;
+class UploadManager;
+class PipelineCache;
+class PipelineManager;
+class ShaderLibrary;
+class ShaderWatcher;
+class BindlessTable;
+class GpuCulling;
+class AssetStreamer;
+class GpuProfiler;
+
+// CPU time spent in each stage of the last draw_frame call, in milliseconds
+struct FrameTimings {
+    double fence_wait = 0.0;
+    double acquire = 0.0;
+    double record = 0.0;
+    double submit = 0.0;
+    double present = 0.0;
+    // GPU time of the newest frame whose timestamps were read back, which
+    // is frames_in_flight frames old. 0 without RendererConfig::gpu_profiling
+    double gpu = 0.0;
+};
+
+// Wall time spent in Renderer::init, in milliseconds
+struct InitTimings {
+    double total = 0.0;
+    double pipelines = 0.0;
+    // A compatible pipeline cache was loaded from disk
+    bool warm_pipeline_cache = false;
+};
+
+// A queued draw, of a registered mesh or of the single mesh when mesh is INVALID_MESH
+struct MeshDraw {
+    MeshHandle mesh = INVALID_MESH;
+    uint32_t uniform_offset = 0;
+};
+
+// One draw of instance_count instances starting at first_instance in the instance ring
+struct InstancedDraw {
+    uint32_t uniform_offset = 0;
+    uint32_t first_instance = 0;
+    uint32_t instance_count = 0;
+};
+
+// Everything owned by one frame in flight. The frame is acquired the first
+// time it is used (its fence waited, its pools, uniform slice and transient
+// buffers recycled) and released when draw_frame submits it.
+struct FrameContext {
+    VkFence in_flight_fence = VK_NULL_HANDLE;
+    VkSemaphore available_semaphore = VK_NULL_HANDLE;
+    VkSemaphore finished_semaphore = VK_NULL_HANDLE;
+
+    // Transient pool reset wholesale before re-recording
+    VkCommandPool command_pool = VK_NULL_HANDLE;
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    // Multi-threaded recording, one pool per partition
+    std::vector<VkCommandPool> secondary_command_pools;
+    std::vector<VkCommandBuffer> secondary_command_buffers;
+
+    // Slice of the uniform ring addressed through the dynamic descriptor set
+    VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+    VkDeviceSize uniform_offset = 0;
+    uint32_t uniform_count = 0;
+    uint32_t default_uniform_offset = 0;
+    // Draws queued for this frame
+    std::vector<MeshDraw> draws;
+    // Slice of the instance ring, in instances, and the instanced draws queued for this frame
+    uint32_t instance_offset = 0;
+    uint32_t instance_count = 0;
+    std::vector<InstancedDraw> instanced_draws;
+    // Camera of the default uniform, culls the GPU-driven objects
+    glm::mat4 view_proj = glm::mat4(1.0f);
+
+    // Deleted once the GPU is done with this frame
+    std::vector<Buffer*> transient_buffers;
+    std::vector<VkPipeline> transient_pipelines;
+    std::vector<MeshHandle> transient_meshes;
+
+    bool acquired = false;
+    double fence_wait = 0.0;
+};
 
 struct RenderData {
 
+    // In headless mode these hold the offscreen color images instead
     std::vector<VkImage> swapchain_images;
     std::vector<VkImageView> swapchain_image_views;
     std::vector<VkFramebuffer> framebuffers;
 
+    std::vector<VmaAllocation> offscreen_allocations;
+    uint32_t offscreen_index = 0;
+    uint32_t last_image_index = 0;
+    Buffer* readback_buffer = nullptr;
+
     Buffer* vertex_buffer = nullptr;
     Buffer* index_buffer  = nullptr;
+    UploadManager* upload_manager = nullptr;
 
     VkDescriptorPool descriptor_pool;
     VkDescriptorSetLayout descriptor_set_layout;
     VkPipelineLayout pipeline_layout;
-    std::vector<VkDescriptorSet> descriptor_sets;
-    std::vector<Buffer*> uniformBuffers;
+    VkDescriptorSet descriptor_set;
+    // Bindless mode: the layout and set above belong to the table, the
+    // uniform ring is its storage buffer uniform_buffer_index
+    BindlessTable* bindless = nullptr;
+    uint32_t uniform_buffer_index = 0;
+
+    // Shared vertex and index buffers of the meshes created with createMesh
+    MeshRegistry* meshes = nullptr;
+    bool optimize_meshes = false;
+    // Loads meshes on worker threads, stream_budget bytes of them are added
+    // to meshes per frame
+    AssetStreamer* streamer = nullptr;
+    size_t stream_budget = 0;
+
+    // Instance ring, one slice of instances_per_frame instances per frame in flight
+    Buffer* instance_buffer = nullptr;
+    uint32_t instances_per_frame = 0;
+    uint32_t instanced_pipeline = UINT32_MAX;
+    VkPipeline instanced_graphics_pipeline = VK_NULL_HANDLE;
+
+    // GPU-driven path, draws culling's objects instead of the draw list when it has any
+    GpuCulling* culling = nullptr;
+    uint32_t indirect_pipeline = UINT32_MAX;
+
+    // Timestamps around the whole frame, the culling dispatch and the main
+    // render pass, only set when profiling
+    GpuProfiler* profiler = nullptr;
+    uint32_t frame_scope = UINT32_MAX;
+    uint32_t cull_scope = UINT32_MAX;
+    uint32_t pass_scope = UINT32_MAX;
+
+    // Uniform ring: frames_in_flight slices of uniforms_per_frame uniforms,
+    // each uniform_stride bytes apart and addressed with dynamic offsets
+    Buffer* uniform_buffer = nullptr;
+    VkDeviceSize uniform_stride = 0;
+    uint32_t uniforms_per_frame = 0;
 
     VkRenderPass render_pass;
-    VkPipeline graphics_pipeline;
+    PipelineCache* pipeline_cache = nullptr;
+    ShaderLibrary* shader_library = nullptr;
+    // Only set when shaders are hot reloaded
+    ShaderWatcher* shader_watcher = nullptr;
+    PipelineManager* pipeline_manager = nullptr;
+    // Workers compiling pipelines, kept apart from job_system so a long
+    // compile never delays a frame's parallel recording
+    JobSystem* compile_jobs = nullptr;
+    uint32_t mesh_pipeline = UINT32_MAX;
+    // mesh_pipeline resolved when recording, VK_NULL_HANDLE while it compiles
+    VkPipeline graphics_pipeline = VK_NULL_HANDLE;
 
-    std::vector<VkCommandBuffer> command_buffers;
+    JobSystem* job_system = nullptr;
+    uint32_t draw_count = 1;
 
-    std::vector<VkSemaphore> available_semaphores;
-    std::vector<VkSemaphore> finished_semaphore;
-    std::vector<VkFence> in_flight_fences;
-    std::vector<VkFence> image_in_flight;
+    std::vector<FrameContext> frames;
+    uint32_t frames_in_flight = 4;
     size_t current_frame = 0;
+    // Frame slot of the last submitted frame and number of frames submitted
+    size_t last_frame = 0;
+    uint64_t frame_number = 0;
+
+    FrameTimings last_timings;
+    InitTimings init_timings;
+
+    // Polled when a frame is acquired. Bit i is set while heap i is over
+    // MEMORY_BUDGET_WARNING of its budget, so crossing it warns once
+    std::vector<HeapBudget> heap_budgets;
+    uint32_t heaps_over_budget = 0;
 };
 
 #endif //RENDER_DATA_H
\ No newline at end of file
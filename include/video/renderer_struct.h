@@ -7,13 +7,28 @@
 
 
 struct VulkanContext {
-    SDL_Window* window;
+    bool headless = false;
+    // Descriptor indexing features are required and resources are bound bindless
+    bool bindless = false;
+    // Indirect count drawing is required for GPU culling
+    bool gpu_culling = false;
+    // Vertex buffers hold CompactVertex instead of Vertex
+    bool compact_vertices = false;
+    // VK_EXT_memory_budget is enabled on the device
+    bool memory_budget = false;
+    SDL_Window* window = nullptr;
     vkb::Instance instance;
     vkb::InstanceDispatchTable inst_disp;
-    VkSurfaceKHR surface;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
     vkb::Device device;
     vkb::DispatchTable disp;
     vkb::Swapchain swapchain;
+
+    // Render target description, taken from the swapchain or from the
+    // offscreen images when running headless
+    VkExtent2D extent;
+    VkFormat color_format;
+
     VkCommandPool command_pool;
 
     VkQueue graphics_queue;
@@ -0,0 +1,29 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+struct UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+};
+
+// Every storage buffer of the bindless table, the uniform ring is one of them
+layout(set = 0, binding = 0) readonly buffer UniformBuffers {
+    UniformBufferObject ubos[];
+} buffers[];
+
+layout(push_constant) uniform DrawConstants {
+    uint uniform_buffer;
+    uint uniform_index;
+} draw;
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    UniformBufferObject ubo = buffers[draw.uniform_buffer].ubos[draw.uniform_index];
+    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 0.0, 1.0);
+    fragColor = inColor;
+}
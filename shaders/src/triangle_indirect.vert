@@ -0,0 +1,28 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+struct GpuObject {
+    mat4 model;
+    vec4 bounds;
+};
+
+layout(set = 1, binding = 0) readonly buffer Objects {
+    GpuObject objects[];
+};
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    // firstInstance of each indirect draw is the object index
+    mat4 model = objects[gl_InstanceIndex].model;
+    gl_Position = ubo.proj * ubo.view * model * vec4(inPosition, 0.0, 1.0);
+    fragColor = inColor;
+}
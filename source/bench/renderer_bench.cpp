@@ -0,0 +1,639 @@
+#define SDL_MAIN_USE_CALLBACKS 1  /* use the callbacks instead of main() */
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/Trace.h"
+#include "video/Renderer.h"
+#include "video/Vertex.h"
+#include "video/UniformBuffer.h"
+
+// Frame-time benchmark for Renderer::drawFrame.
+//
+// usage: renderer_bench [--window] [--frames N] [--warmup N] [--size WxH]
+//                       [--scene VERTICES:DRAWS:FRAMES_IN_FLIGHT[:THREADS]]...
+//                       [--thread-sweep] [--instancing] [--startup RUNS]
+//                       [--compact-vertices] [--gpu-profile] [--trace FILE]
+//                       [--output FILE]
+//
+// Runs headless by default so it works on lavapipe, and prints one JSON
+// document with a result entry per scene. THREADS is the number of
+// recording threads (0 records inline). --thread-sweep runs every scene
+// with 0, 1, 2, 4, ... up to the hardware thread count to show how
+// recording time scales with cores.
+//
+// --instancing runs every scene twice with a distinct transform per draw:
+// once as DRAWS individual draws, each with its own uniform, and once as a
+// single instanced draw of DRAWS instances.
+//
+// --compact-vertices uploads every mesh as 8 byte CompactVertex instead of
+// the 20 byte Vertex.
+//
+// --gpu-profile adds a "gpu" entry per scene: the frame's GPU time from
+// timestamp queries, read back frames_in_flight frames late.
+//
+// --trace writes the CPU zones of the last frames of the run to FILE in
+// Chrome trace format. Zones are only recorded in builds configured with
+// RENDERER_TRACE.
+//
+// --startup times Renderer::init RUNS times with the pipeline cache file
+// deleted (cold) and RUNS times with the cache left by the previous run
+// (warm). Scenes only run alongside it when given explicitly.
+
+enum class DrawMode {
+    // draw_count copies sharing the default uniform, setDrawCount
+    Repeated,
+    // draw_count draws each pushing its own uniform, drawMesh
+    Individual,
+    // One draw of draw_count instances, drawInstanced
+    Instanced,
+};
+
+const char* draw_mode_name(DrawMode mode)
+{
+    switch (mode)
+    {
+        case DrawMode::Individual: return "individual";
+        case DrawMode::Instanced: return "instanced";
+        default: return "repeated";
+    }
+}
+
+struct Scene {
+    uint32_t vertex_count;
+    uint32_t draw_count;
+    uint32_t frames_in_flight;
+    uint32_t recording_threads = 0;
+    DrawMode draw_mode = DrawMode::Repeated;
+};
+
+struct BenchConfig {
+    bool headless = true;
+    uint32_t width = 256;
+    uint32_t height = 256;
+    uint32_t frames = 500;
+    uint32_t warmup = 50;
+    bool thread_sweep = false;
+    bool instancing = false;
+    bool compact_vertices = false;
+    bool gpu_profile = false;
+    uint32_t startup_runs = 0;
+    std::vector<Scene> scenes;
+    std::string output;
+    std::string trace;
+    std::string pipeline_cache = "renderer_bench_pipeline_cache.bin";
+};
+
+struct Percentiles {
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+struct SceneResult {
+    Scene scene;
+    double total_ms = 0.0;
+    Percentiles frame;
+    Percentiles fence_wait;
+    Percentiles acquire;
+    Percentiles record;
+    Percentiles submit;
+    Percentiles present;
+    Percentiles gpu;
+};
+
+struct StartupResult {
+    Percentiles cold_total;
+    Percentiles cold_pipelines;
+    Percentiles warm_total;
+    Percentiles warm_pipelines;
+    // Warm runs that actually found a compatible cache on disk
+    uint32_t warm_hits = 0;
+};
+
+Percentiles compute_percentiles(std::vector<double> samples)
+{
+    Percentiles result;
+    if (samples.empty())
+    {
+        return result;
+    }
+    std::sort(samples.begin(), samples.end());
+
+    auto rank = [&samples](double p) {
+        size_t index = static_cast<size_t>(p * (samples.size() - 1) + 0.5);
+        return samples[std::min(index, samples.size() - 1)];
+    };
+
+    double sum = 0.0;
+    for (double s : samples)
+    {
+        sum += s;
+    }
+    result.mean = sum / samples.size();
+    result.p50 = rank(0.50);
+    result.p90 = rank(0.90);
+    result.p99 = rank(0.99);
+    result.max = samples.back();
+    return result;
+}
+
+// Grid of small quads covering clip space, four vertices per quad. The
+// renderer narrows the indices to 16 bit when the mesh is small enough
+void generate_mesh(uint32_t vertex_count, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    uint32_t quad_count = std::max(1u, vertex_count / 4);
+    uint32_t side = 1;
+    while (side * side < quad_count)
+    {
+        side++;
+    }
+    float step = 2.0f / side;
+
+    vertices.clear();
+    indices.clear();
+    vertices.reserve(quad_count * 4);
+    indices.reserve(quad_count * 6);
+    for (uint32_t q = 0; q < quad_count; q++)
+    {
+        float x = -1.0f + (q % side) * step;
+        float y = -1.0f + (q / side) * step;
+        float s = step * 0.9f;
+        uint32_t base = static_cast<uint32_t>(vertices.size());
+
+        vertices.push_back({{x, y}, {1.0f, 0.0f, 0.0f}});
+        vertices.push_back({{x + s, y}, {0.0f, 1.0f, 0.0f}});
+        vertices.push_back({{x + s, y + s}, {0.0f, 0.0f, 1.0f}});
+        vertices.push_back({{x, y + s}, {1.0f, 1.0f, 1.0f}});
+
+        indices.insert(indices.end(), { base, base + 1, base + 2, base + 2, base + 3, base });
+    }
+}
+
+// Per object transforms spreading draw_count copies of the mesh over a grid,
+// shrunk so they overlap the same screen area as a single copy would
+void generate_instances(uint32_t draw_count, std::vector<Instance>& instances)
+{
+    uint32_t side = 1;
+    while (side * side < draw_count)
+    {
+        side++;
+    }
+    float scale = 1.0f / side;
+
+    instances.resize(draw_count);
+    for (uint32_t i = 0; i < draw_count; i++)
+    {
+        glm::vec3 offset(-1.0f + (2 * (i % side) + 1) * scale, -1.0f + (2 * (i / side) + 1) * scale, 0.0f);
+        instances[i].transform = glm::scale(glm::translate(glm::mat4(1.0f), offset), glm::vec3(scale, scale, 1.0f));
+        instances[i].color = glm::vec4(1.0f);
+    }
+}
+
+// Queues one frame of draws for the scene's draw mode
+bool submit_draws(Renderer& renderer, const Scene& scene, const UniformBufferObject& ubo, const std::vector<Instance>& instances)
+{
+    switch (scene.draw_mode)
+    {
+        case DrawMode::Individual:
+        {
+            UniformBufferObject object_ubo = ubo;
+            for (const Instance& instance : instances)
+            {
+                uint32_t offset = 0;
+                object_ubo.model = instance.transform;
+                if (renderer.pushUniform(object_ubo, offset))
+                {
+                    return true;
+                }
+                renderer.drawMesh(offset);
+            }
+            return false;
+        }
+        case DrawMode::Instanced:
+        {
+            uint32_t offset = 0;
+            if (renderer.pushUniform(ubo, offset))
+            {
+                return true;
+            }
+            return renderer.drawInstanced(instances.data(), static_cast<uint32_t>(instances.size()), offset);
+        }
+        default:
+            return renderer.updateUniformBuffer(ubo);
+    }
+}
+
+bool run_scene(const BenchConfig& config, const Scene& scene, SceneResult& result)
+{
+    Renderer renderer;
+    RendererConfig renderer_config;
+    renderer_config.width = config.width;
+    renderer_config.height = config.height;
+    renderer_config.headless = config.headless;
+    renderer_config.frames_in_flight = scene.frames_in_flight;
+    renderer_config.recording_threads = scene.recording_threads;
+    renderer_config.compact_vertices = config.compact_vertices;
+    renderer_config.gpu_profiling = config.gpu_profile;
+    renderer_config.pipeline_cache_path = config.pipeline_cache;
+    renderer_config.max_draws_per_frame = std::max(renderer_config.max_draws_per_frame, scene.draw_count);
+    if (scene.draw_mode == DrawMode::Instanced)
+    {
+        renderer_config.max_instances_per_frame = scene.draw_count;
+    }
+
+    if (renderer.init(renderer_config))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to init Renderer");
+        return true;
+    }
+    renderer.waitForPipelines();
+
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    generate_mesh(scene.vertex_count, vertices, indices);
+    if (renderer.createVertexBuffer(vertices) || renderer.createIndicesBuffer(indices))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to upload bench mesh");
+        return true;
+    }
+
+    renderer.setDrawCount(scene.draw_count);
+    std::vector<Instance> instances;
+    if (scene.draw_mode != DrawMode::Repeated)
+    {
+        generate_instances(scene.draw_count, instances);
+    }
+
+    UniformBufferObject ubo = {};
+    ubo.model = glm::mat4(1.0f);
+    ubo.view = glm::mat4(1.0f);
+    ubo.proj = glm::mat4(1.0f);
+
+    for (uint32_t i = 0; i < config.warmup; i++)
+    {
+        if (submit_draws(renderer, scene, ubo, instances) || renderer.drawFrame())
+        {
+            return true;
+        }
+    }
+    renderer.waitIdle();
+
+    std::vector<double> frame, fence_wait, acquire, record, submit, present, gpu;
+    frame.reserve(config.frames);
+    fence_wait.reserve(config.frames);
+    acquire.reserve(config.frames);
+    record.reserve(config.frames);
+    submit.reserve(config.frames);
+    present.reserve(config.frames);
+
+    auto bench_start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < config.frames; i++)
+    {
+        auto frame_start = std::chrono::steady_clock::now();
+        if (submit_draws(renderer, scene, ubo, instances) || renderer.drawFrame())
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to draw frame ");
+            return true;
+        }
+        frame.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start).count());
+
+        const FrameTimings& timings = renderer.getLastFrameTimings();
+        fence_wait.push_back(timings.fence_wait);
+        acquire.push_back(timings.acquire);
+        record.push_back(timings.record);
+        submit.push_back(timings.submit);
+        present.push_back(timings.present);
+        // 0 until the first profiled frame is read back
+        if (timings.gpu > 0.0)
+        {
+            gpu.push_back(timings.gpu);
+        }
+
+        if (!config.headless)
+        {
+            SDL_Event event;
+            while (SDL_PollEvent(&event)) {}
+        }
+    }
+    // Count the GPU work still queued at the end of the run
+    renderer.waitIdle();
+    result.total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - bench_start).count();
+
+    result.scene = scene;
+    result.frame = compute_percentiles(frame);
+    result.fence_wait = compute_percentiles(fence_wait);
+    result.acquire = compute_percentiles(acquire);
+    result.record = compute_percentiles(record);
+    result.submit = compute_percentiles(submit);
+    result.present = compute_percentiles(present);
+    result.gpu = compute_percentiles(gpu);
+    return false;
+}
+
+bool run_startup(const BenchConfig& config, StartupResult& result)
+{
+    // Mesa keeps its own on-disk shader cache, which would make the cold
+    // runs warm after the first one
+    SDL_setenv_unsafe("MESA_SHADER_CACHE_DISABLE", "true", 0);
+
+    RendererConfig renderer_config;
+    renderer_config.width = config.width;
+    renderer_config.height = config.height;
+    renderer_config.headless = config.headless;
+    renderer_config.pipeline_cache_path = config.pipeline_cache;
+    // Compile during init so it is part of the measured time
+    renderer_config.pipeline_compile_threads = 0;
+
+    std::vector<double> cold_total, cold_pipelines, warm_total, warm_pipelines;
+    for (int warm = 0; warm < 2; warm++)
+    {
+        for (uint32_t i = 0; i < config.startup_runs; i++)
+        {
+            if (!warm)
+            {
+                std::remove(config.pipeline_cache.c_str());
+            }
+
+            // The cache is written back when the renderer is destroyed
+            Renderer renderer;
+            if (renderer.init(renderer_config))
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to init Renderer");
+                return true;
+            }
+
+            const InitTimings& timings = renderer.getInitTimings();
+            (warm ? warm_total : cold_total).push_back(timings.total);
+            (warm ? warm_pipelines : cold_pipelines).push_back(timings.pipelines);
+            if (warm && timings.warm_pipeline_cache)
+            {
+                result.warm_hits++;
+            }
+        }
+    }
+
+    result.cold_total = compute_percentiles(cold_total);
+    result.cold_pipelines = compute_percentiles(cold_pipelines);
+    result.warm_total = compute_percentiles(warm_total);
+    result.warm_pipelines = compute_percentiles(warm_pipelines);
+    return false;
+}
+
+void write_percentiles(std::ostream& out, const char* name, const Percentiles& p, bool last = false)
+{
+    out << "      \"" << name << "\": { "
+        << "\"mean\": " << p.mean << ", "
+        << "\"p50\": " << p.p50 << ", "
+        << "\"p90\": " << p.p90 << ", "
+        << "\"p99\": " << p.p99 << ", "
+        << "\"max\": " << p.max << " }" << (last ? "" : ",") << "\n";
+}
+
+void write_json(std::ostream& out, const BenchConfig& config, const std::vector<SceneResult>& results, const StartupResult& startup)
+{
+    out << "{\n";
+    out << "  \"headless\": " << (config.headless ? "true" : "false") << ",\n";
+    out << "  \"width\": " << config.width << ",\n";
+    out << "  \"height\": " << config.height << ",\n";
+    out << "  \"frames\": " << config.frames << ",\n";
+    out << "  \"warmup\": " << config.warmup << ",\n";
+    out << "  \"compact_vertices\": " << (config.compact_vertices ? "true" : "false") << ",\n";
+    out << "  \"unit\": \"ms\",\n";
+    if (config.startup_runs > 0)
+    {
+        out << "  \"startup\": {\n";
+        out << "      \"runs\": " << config.startup_runs << ",\n";
+        out << "      \"warm_hits\": " << startup.warm_hits << ",\n";
+        write_percentiles(out, "cold_total", startup.cold_total);
+        write_percentiles(out, "cold_pipelines", startup.cold_pipelines);
+        write_percentiles(out, "warm_total", startup.warm_total);
+        write_percentiles(out, "warm_pipelines", startup.warm_pipelines, true);
+        out << "  },\n";
+    }
+    out << "  \"scenes\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const SceneResult& r = results[i];
+        double fps = r.total_ms > 0.0 ? config.frames * 1000.0 / r.total_ms : 0.0;
+        out << "    {\n";
+        out << "      \"vertex_count\": " << r.scene.vertex_count << ",\n";
+        out << "      \"draw_count\": " << r.scene.draw_count << ",\n";
+        out << "      \"frames_in_flight\": " << r.scene.frames_in_flight << ",\n";
+        out << "      \"recording_threads\": " << r.scene.recording_threads << ",\n";
+        out << "      \"draw_mode\": \"" << draw_mode_name(r.scene.draw_mode) << "\",\n";
+        out << "      \"total_ms\": " << r.total_ms << ",\n";
+        out << "      \"fps\": " << fps << ",\n";
+        write_percentiles(out, "frame", r.frame);
+        write_percentiles(out, "fence_wait", r.fence_wait);
+        write_percentiles(out, "acquire", r.acquire);
+        write_percentiles(out, "record", r.record);
+        write_percentiles(out, "submit", r.submit);
+        write_percentiles(out, "present", r.present, !config.gpu_profile);
+        if (config.gpu_profile)
+        {
+            write_percentiles(out, "gpu", r.gpu, true);
+        }
+        out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+bool parse_scene(const char* arg, Scene& scene)
+{
+    scene.recording_threads = 0;
+    int fields = sscanf(arg, "%u:%u:%u:%u", &scene.vertex_count, &scene.draw_count,
+                        &scene.frames_in_flight, &scene.recording_threads);
+    return fields >= 3 && scene.frames_in_flight > 0;
+}
+
+bool parse_args(int argc, char const *argv[], BenchConfig& config)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--window") == 0)
+        {
+            config.headless = false;
+        }
+        else if (strcmp(argv[i], "--thread-sweep") == 0)
+        {
+            config.thread_sweep = true;
+        }
+        else if (strcmp(argv[i], "--instancing") == 0)
+        {
+            config.instancing = true;
+        }
+        else if (strcmp(argv[i], "--compact-vertices") == 0)
+        {
+            config.compact_vertices = true;
+        }
+        else if (strcmp(argv[i], "--gpu-profile") == 0)
+        {
+            config.gpu_profile = true;
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && has_value)
+        {
+            config.frames = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--startup") == 0 && has_value)
+        {
+            config.startup_runs = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--warmup") == 0 && has_value)
+        {
+            config.warmup = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--size") == 0 && has_value)
+        {
+            if (sscanf(argv[++i], "%ux%u", &config.width, &config.height) != 2)
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "invalid size %s, expected WxH", argv[i]);
+                return true;
+            }
+        }
+        else if (strcmp(argv[i], "--scene") == 0 && has_value)
+        {
+            Scene scene;
+            if (!parse_scene(argv[++i], scene))
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "invalid scene %s, expected VERTICES:DRAWS:FRAMES_IN_FLIGHT[:THREADS]", argv[i]);
+                return true;
+            }
+            config.scenes.push_back(scene);
+        }
+        else if (strcmp(argv[i], "--output") == 0 && has_value)
+        {
+            config.output = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && has_value)
+        {
+            config.trace = argv[++i];
+        }
+        else
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "unknown argument %s", argv[i]);
+            return true;
+        }
+    }
+
+    if (config.scenes.empty() && config.startup_runs == 0)
+    {
+        config.scenes = {
+            { 4, 1, 2 },
+            { 4, 1, 4 },
+            { 4096, 16, 2 },
+            { 65536, 64, 4 },
+            { 4, 20000, 2, 4 },
+        };
+    }
+
+    if (config.instancing)
+    {
+        std::vector<Scene> variants;
+        for (const Scene& scene : config.scenes)
+        {
+            Scene variant = scene;
+            variant.draw_mode = DrawMode::Individual;
+            variants.push_back(variant);
+            variant.draw_mode = DrawMode::Instanced;
+            variants.push_back(variant);
+        }
+        config.scenes = variants;
+    }
+
+    if (config.thread_sweep)
+    {
+        uint32_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<Scene> swept;
+        for (const Scene& scene : config.scenes)
+        {
+            Scene variant = scene;
+            variant.recording_threads = 0;
+            swept.push_back(variant);
+            for (uint32_t threads = 1; threads <= max_threads; threads *= 2)
+            {
+                variant.recording_threads = threads;
+                swept.push_back(variant);
+            }
+            if ((max_threads & (max_threads - 1)) != 0)
+            {
+                variant.recording_threads = max_threads;
+                swept.push_back(variant);
+            }
+        }
+        config.scenes = swept;
+    }
+    return false;
+}
+
+int main(int argc, char const *argv[])
+{
+    BenchConfig config;
+    if (parse_args(argc, argv, config))
+    {
+        return 1;
+    }
+
+    StartupResult startup;
+    if (config.startup_runs > 0 && run_startup(config, startup))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "startup benchmark failed");
+        return 1;
+    }
+
+    std::vector<SceneResult> results;
+    for (const Scene& scene : config.scenes)
+    {
+        SceneResult result;
+        if (run_scene(config, scene, result))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "scene %u:%u:%u:%u %s failed",
+                         scene.vertex_count, scene.draw_count, scene.frames_in_flight, scene.recording_threads,
+                         draw_mode_name(scene.draw_mode));
+            return 1;
+        }
+        results.push_back(result);
+    }
+
+    if (!config.trace.empty())
+    {
+#ifndef RENDERER_TRACE
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "built without RENDERER_TRACE, %s has no zones", config.trace.c_str());
+#endif
+        if (trace_write_chrome_json(config.trace))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to write %s", config.trace.c_str());
+            return 1;
+        }
+    }
+
+    if (config.output.empty())
+    {
+        write_json(std::cout, config, results, startup);
+    }
+    else
+    {
+        std::ofstream file(config.output);
+        if (!file.is_open())
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "failed to open %s", config.output.c_str());
+            return 1;
+        }
+        write_json(file, config, results, startup);
+    }
+    return 0;
+}
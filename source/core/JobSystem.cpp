@@ -0,0 +1,106 @@
+#include "core/JobSystem.h"
+
+#include "core/Trace.h"
+
+JobSystem::JobSystem(uint32_t thread_count)
+{
+    if (thread_count == 0)
+    {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_workers.reserve(thread_count);
+    for (uint32_t i = 0; i < thread_count; i++)
+    {
+        m_workers.emplace_back(&JobSystem::workerLoop, this);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_job_available.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+uint32_t JobSystem::getThreadCount() const
+{
+    return static_cast<uint32_t>(m_workers.size());
+}
+
+void JobSystem::workerLoop()
+{
+    TRACE_THREAD_NAME("worker");
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_job_available.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+            if (m_jobs.empty())
+            {
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending--;
+            if (m_pending == 0)
+            {
+                m_jobs_done.notify_all();
+            }
+        }
+    }
+}
+
+void JobSystem::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+        m_pending++;
+    }
+    m_job_available.notify_one();
+}
+
+void JobSystem::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobs_done.wait(lock, [this] { return m_pending == 0; });
+}
+
+void JobSystem::parallelFor(uint32_t count, const std::function<void(uint32_t)>& job)
+{
+    // Own completion counter so unrelated jobs in the queue are not waited on
+    std::mutex done_mutex;
+    std::condition_variable done;
+    uint32_t remaining = count;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        submit([&, i] {
+            job(i);
+            std::lock_guard<std::mutex> lock(done_mutex);
+            remaining--;
+            if (remaining == 0)
+            {
+                done.notify_one();
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done.wait(lock, [&] { return remaining == 0; });
+}
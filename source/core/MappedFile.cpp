@@ -0,0 +1,115 @@
+#include "core/MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path)
+{
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("failed to open " + path);
+    }
+    m_copy.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(m_copy.data(), static_cast<std::streamsize>(m_copy.size()));
+    m_data = m_copy.data();
+    m_size = m_copy.size();
+#else
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error("failed to open " + path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("failed to stat " + path);
+    }
+    m_size = static_cast<size_t>(info.st_size);
+
+    // mmap rejects empty mappings, an empty file is just an empty view
+    if (m_size > 0)
+    {
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error("failed to map " + path);
+        }
+        m_data = data;
+    }
+    // The mapping keeps its own reference to the file
+    close(fd);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : m_data(other.m_data), m_size(other.m_size), m_copy(std::move(other.m_copy))
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        m_data = other.m_data;
+        m_size = other.m_size;
+        m_copy = std::move(other.m_copy);
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+    return *this;
+}
+
+void MappedFile::release()
+{
+#ifndef _WIN32
+    if (m_data != nullptr)
+    {
+        munmap(const_cast<void*>(m_data), m_size);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_copy.clear();
+}
+
+const void* MappedFile::getData() const
+{
+    return m_data;
+}
+
+size_t MappedFile::getSize() const
+{
+    return m_size;
+}
+
+void MappedFile::prefetch() const
+{
+#ifndef _WIN32
+    if (m_data != nullptr && m_copy.empty())
+    {
+        madvise(const_cast<void*>(m_data), m_size, MADV_WILLNEED);
+    }
+#endif
+}
@@ -0,0 +1,208 @@
+#include "core/Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct TraceEvent
+{
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// Single writer ring. Slots are atomics so the exporter may read while the
+// owning thread keeps writing, it drops whatever was overwritten meanwhile.
+struct TraceBuffer
+{
+    struct Slot
+    {
+        std::atomic<const char*> name{ nullptr };
+        std::atomic<uint64_t> start{ 0 };
+        std::atomic<uint64_t> end{ 0 };
+    };
+
+    std::vector<Slot> slots;
+    // Events ever written, the next one goes to slots[head % size]
+    std::atomic<uint64_t> head{ 0 };
+    uint32_t thread_id;
+    // Guarded by the registry mutex
+    std::string thread_name;
+
+    TraceBuffer(uint32_t id) : slots(TRACE_EVENTS_PER_THREAD), thread_id(id) {}
+};
+
+// Buffers outlive their threads so zones of finished threads still export
+struct TraceRegistry
+{
+    std::mutex mutex;
+    std::vector<TraceBuffer*> buffers;
+};
+
+TraceRegistry& get_registry()
+{
+    static TraceRegistry* registry = new TraceRegistry();
+    return *registry;
+}
+
+thread_local TraceBuffer* t_buffer = nullptr;
+
+TraceBuffer& get_thread_buffer()
+{
+    if (t_buffer == nullptr)
+    {
+        TraceRegistry& registry = get_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        t_buffer = new TraceBuffer(static_cast<uint32_t>(registry.buffers.size()));
+        registry.buffers.push_back(t_buffer);
+    }
+    return *t_buffer;
+}
+
+// Events of the buffer that were not overwritten while they were copied
+void copy_events(TraceBuffer& buffer, std::vector<TraceEvent>& events)
+{
+    const uint64_t size = buffer.slots.size();
+    uint64_t head = buffer.head.load(std::memory_order_acquire);
+    uint64_t first = head > size ? head - size : 0;
+
+    size_t copied_from = events.size();
+    for (uint64_t i = first; i < head; i++)
+    {
+        const TraceBuffer::Slot& slot = buffer.slots[i % size];
+        events.push_back({ slot.name.load(std::memory_order_relaxed),
+                           slot.start.load(std::memory_order_relaxed),
+                           slot.end.load(std::memory_order_relaxed) });
+    }
+
+    // The writer may have wrapped over the oldest copied slots, and is
+    // possibly halfway through the one after its new head. Pairs with the
+    // fence in trace_record: a slot read that saw an overwrite also sees the
+    // head that was stored before it
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t new_head = buffer.head.load(std::memory_order_relaxed);
+    uint64_t valid_from = new_head + 1 > size ? new_head + 1 - size : 0;
+    if (valid_from > first)
+    {
+        size_t dropped = static_cast<size_t>(std::min(valid_from, head) - first);
+        events.erase(events.begin() + copied_from, events.begin() + copied_from + dropped);
+    }
+}
+
+void write_json_string(std::ostream& out, const char* text)
+{
+    out << '"';
+    for (const char* c = text; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            out << '\\';
+        }
+        out << *c;
+    }
+    out << '"';
+}
+
+}
+
+uint64_t trace_now()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void trace_record(const char* name, uint64_t start, uint64_t end)
+{
+    TraceBuffer& buffer = get_thread_buffer();
+    uint64_t index = buffer.head.load(std::memory_order_relaxed);
+    TraceBuffer::Slot& slot = buffer.slots[index % buffer.slots.size()];
+    // Orders the previous head store before the overwrite of this slot
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    buffer.head.store(index + 1, std::memory_order_release);
+}
+
+void trace_set_thread_name(const std::string& name)
+{
+    TraceBuffer& buffer = get_thread_buffer();
+    std::lock_guard<std::mutex> lock(get_registry().mutex);
+    buffer.thread_name = name;
+}
+
+void trace_write_chrome_json(std::ostream& out)
+{
+    TraceRegistry& registry = get_registry();
+    std::vector<TraceBuffer*> buffers;
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        buffers = registry.buffers;
+        for (TraceBuffer* buffer : buffers)
+        {
+            names.push_back(buffer->thread_name);
+        }
+    }
+
+    std::vector<std::vector<TraceEvent>> events(buffers.size());
+    uint64_t origin = UINT64_MAX;
+    for (size_t i = 0; i < buffers.size(); i++)
+    {
+        copy_events(*buffers[i], events[i]);
+        for (const TraceEvent& event : events[i])
+        {
+            origin = std::min(origin, event.start);
+        }
+    }
+
+    // Timestamps are microseconds since the oldest exported zone, kept to
+    // the nanosecond however long the trace is
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (size_t i = 0; i < buffers.size(); i++)
+    {
+        uint32_t tid = buffers[i]->thread_id;
+        if (!names[i].empty())
+        {
+            out << (first ? "\n" : ",\n");
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+            write_json_string(out, names[i].c_str());
+            out << "}}";
+            first = false;
+        }
+        for (const TraceEvent& event : events[i])
+        {
+            out << (first ? "\n" : ",\n");
+            out << "{\"name\":";
+            write_json_string(out, event.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                << ",\"ts\":" << (event.start - origin) / 1000.0
+                << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    out.flags(flags);
+    out.precision(precision);
+}
+
+bool trace_write_chrome_json(const std::string& path)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open())
+    {
+        return true;
+    }
+    trace_write_chrome_json(file);
+    return !file.good();
+}
@@ -2,6 +2,8 @@
 #include <SDL3/SDL.h>
 
 #include <chrono>
+#include <cstring>
+#include <cstdlib>
 #include <vector>
 #include <iostream>
 
@@ -37,6 +39,46 @@ void calculateNewUniformBuffer(UniformBufferObject& ubo, uint32_t width, uint32_
     ubo.proj[1][1] *= -1;
 }
 
+// Queues the loaded mesh with the frame's uniform, or sets the uniform the
+// default quad is drawn with when there is no mesh. Returns true on failure
+bool queue_frame(Renderer& renderer, const UniformBufferObject& ubo, MeshHandle mesh)
+{
+    if (mesh == INVALID_MESH)
+    {
+        return renderer.updateUniformBuffer(ubo);
+    }
+    uint32_t offset = 0;
+    if (renderer.pushUniform(ubo, offset))
+    {
+        return true;
+    }
+    renderer.drawMesh(mesh, offset);
+    return false;
+}
+
+int run_headless(Renderer& renderer, UniformBufferObject& ubo, MeshHandle mesh, uint32_t frame_count)
+{
+    // Every frame should show the mesh, not a clear while the pipeline compiles
+    renderer.waitForPipelines();
+    for (uint32_t i = 0; i < frame_count; i++)
+    {
+        if (queue_frame(renderer, ubo, mesh) || renderer.drawFrame())
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to draw frame ");
+            return true;
+        }
+    }
+
+    std::vector<uint8_t> pixels;
+    if (renderer.readFrame(pixels))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to read back frame");
+        return true;
+    }
+    std::cout << "Rendered " << frame_count << " headless frames, read back " << pixels.size() << " bytes" << std::endl;
+    return 0;
+}
+
 int main(int argc, char const *argv[])
 {
     Renderer renderer;
@@ -45,16 +87,76 @@ int main(int argc, char const *argv[])
     ubo.view = glm::mat4(1.0f);
     ubo.proj = glm::mat4(1.0f);
 
-    if (renderer.init(SCREEN_WIDTH, SCREEN_HEIGHT))
+    // --headless [frames]: render offscreen without a window and exit
+    // --hot-reload: rebuild pipelines when a .spv in the shader folder changes
+    // --mesh FILE: draw a binary mesh file written by mesh_converter instead of the quad
+    // --memory-stats FILE: write the renderer's memory statistics as JSON on exit
+    // --pipeline-cache FILE: load the pipeline cache from FILE and save it back on exit
+    RendererConfig config;
+    config.width = SCREEN_WIDTH;
+    config.height = SCREEN_HEIGHT;
+    uint32_t headless_frames = 60;
+    const char* mesh_path = nullptr;
+    const char* memory_stats_path = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--headless") == 0)
+        {
+            config.headless = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                headless_frames = static_cast<uint32_t>(atoi(argv[++i]));
+            }
+        }
+        else if (strcmp(argv[i], "--hot-reload") == 0)
+        {
+            config.hot_reload_shaders = true;
+        }
+        else if (strcmp(argv[i], "--mesh") == 0 && i + 1 < argc)
+        {
+            mesh_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--memory-stats") == 0 && i + 1 < argc)
+        {
+            memory_stats_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--pipeline-cache") == 0 && i + 1 < argc)
+        {
+            config.pipeline_cache_path = argv[++i];
+        }
+    }
+
+    if (renderer.init(config))
     {
         SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to init Renderer");
         return true;
     }
 
-    renderer.createVertexBuffer(vertices);
-    renderer.createIndicesBuffer(indices);
+    MeshHandle mesh = INVALID_MESH;
+    if (mesh_path != nullptr)
+    {
+        if (renderer.loadMesh(mesh_path, mesh))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to load %s", mesh_path);
+            return true;
+        }
+    }
+    else
+    {
+        renderer.createVertexBuffer(vertices);
+        renderer.createIndicesBuffer(indices);
+    }
+
+    if (config.headless)
+    {
+        int result = run_headless(renderer, ubo, mesh, headless_frames);
+        if (memory_stats_path != nullptr)
+        {
+            renderer.writeMemoryStats(memory_stats_path);
+        }
+        return result;
+    }
 
-    renderer.recordCommandBuffer();
     SDL_Event event;
     while (event.type != SDL_EVENT_QUIT)
     {
@@ -62,10 +164,13 @@ int main(int argc, char const *argv[])
         if (event.type == SDL_EVENT_WINDOW_RESIZED)
         {
             renderer.resize();
-            renderer.recordCommandBuffer();
         }
         // calculateNewUniformBuffer(ubo, SCREEN_WIDTH, SCREEN_HEIGHT);
-        renderer.updateUniformBuffer(ubo);
+        if (queue_frame(renderer, ubo, mesh))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to queue frame ");
+            return true;
+        }
         int res = renderer.drawFrame();
         if (res != 0)
         {
@@ -74,5 +179,9 @@ int main(int argc, char const *argv[])
         }
     }
 
+    if (memory_stats_path != nullptr)
+    {
+        renderer.writeMemoryStats(memory_stats_path);
+    }
     return 0;
 }
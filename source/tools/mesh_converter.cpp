@@ -0,0 +1,88 @@
+#include <SDL3/SDL.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "video/MeshFile.h"
+#include "video/MeshOptimizer.h"
+#include "video/ObjLoader.h"
+#include "video/Vertex.h"
+#include "video/VertexQuantize.h"
+
+// Converts an OBJ file into the binary mesh format read by
+// Renderer::loadMesh and Renderer::streamMesh.
+//
+// usage: mesh_converter [--optimize] [--compact] INPUT.obj OUTPUT.mesh
+//
+// --optimize runs optimize_mesh first, so loading does not have to.
+// --compact stores CompactVertex instead of Vertex, for renderers created
+// with RendererConfig::compact_vertices. A renderer with compact vertices
+// also loads full Vertex files, quantizing them on load.
+
+int main(int argc, char const *argv[])
+{
+    bool optimize = false;
+    bool compact = false;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--optimize") == 0)
+        {
+            optimize = true;
+        }
+        else if (strcmp(argv[i], "--compact") == 0)
+        {
+            compact = true;
+        }
+        else if (argv[i][0] == '-')
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "unknown argument %s", argv[i]);
+            return 1;
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.size() != 2)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "usage: mesh_converter [--optimize] [--compact] INPUT.obj OUTPUT.mesh");
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    if (load_obj(paths[0], vertices, indices))
+    {
+        return 1;
+    }
+    if (optimize)
+    {
+        optimize_mesh(vertices, indices);
+    }
+
+    bool failed = false;
+    if (compact)
+    {
+        std::vector<CompactVertex> compact_vertices;
+        quantize_vertices(vertices, compact_vertices);
+        failed = write_mesh_file(paths[1], compact_vertices, indices);
+    }
+    else
+    {
+        failed = write_mesh_file(paths[1], vertices, indices);
+    }
+    if (failed)
+    {
+        return 1;
+    }
+
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << paths[0] << " -> " << paths[1] << ": " << vertices.size() << " vertices, "
+              << indices.size() / 3 << " triangles in " << elapsed << " ms" << std::endl;
+    return 0;
+}
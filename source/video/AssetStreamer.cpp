@@ -0,0 +1,193 @@
+#include "video/AssetStreamer.h"
+
+#include <SDL3/SDL.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#include "core/JobSystem.h"
+#include "core/Trace.h"
+#include "video/MeshOptimizer.h"
+#include "video/ObjLoader.h"
+#include "video/VertexQuantize.h"
+
+AssetStreamer::AssetStreamer(uint32_t thread_count, bool optimize, bool compact, uint32_t max_index_value)
+    : m_jobs(new JobSystem(thread_count)), m_optimize(optimize), m_compact(compact), m_max_index_value(max_index_value)
+{
+}
+
+AssetStreamer::~AssetStreamer()
+{
+    // Jobs still queued return right away, the workers join once they ran
+    m_stopping.store(true, std::memory_order_relaxed);
+    delete m_jobs;
+}
+
+static bool is_obj_file(const std::string& path)
+{
+    return path.size() >= 4 && path.compare(path.size() - 4, 4, ".obj") == 0;
+}
+
+bool AssetStreamer::mapMeshFile(const std::string& path, Block& block, std::vector<Vertex>& vertices)
+{
+    try
+    {
+        block.file = MappedFile(path);
+    }
+    catch(const std::runtime_error& e)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to read %s: %s", path.c_str(), e.what());
+        return true;
+    }
+
+    MeshFileView view;
+    if (read_mesh_file(block.file.getData(), block.file.getSize(), view, m_max_index_value))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to read %s", path.c_str());
+        return true;
+    }
+
+    if (m_compact ? view.hasLayout<CompactVertex>() : view.hasLayout<Vertex>())
+    {
+        // Pages are read in now rather than when the render thread copies them
+        block.file.prefetch();
+        block.view = view;
+        return false;
+    }
+    if (!view.hasLayout<Vertex>())
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "%s vertex layout does not match the renderer's", path.c_str());
+        return true;
+    }
+
+    // Full vertices for a compact renderer, quantized like an OBJ
+    const Vertex* file_vertices = static_cast<const Vertex*>(view.vertices);
+    vertices.assign(file_vertices, file_vertices + view.header->vertex_count);
+    if (view.getIndexType() == VK_INDEX_TYPE_UINT16)
+    {
+        const uint16_t* indices = static_cast<const uint16_t*>(view.indices);
+        block.indices.assign(indices, indices + view.header->index_count);
+    }
+    else
+    {
+        const uint32_t* indices = static_cast<const uint32_t*>(view.indices);
+        block.indices.assign(indices, indices + view.header->index_count);
+    }
+    block.file = MappedFile();
+    return false;
+}
+
+// Runs on a worker, everything but the copy into staging happens here
+void AssetStreamer::load(StreamRequest request, const std::string& path)
+{
+    TRACE_ZONE("stream load");
+    Block block;
+    block.request = request;
+    if (m_stopping.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    std::vector<Vertex> vertices;
+    bool failed = is_obj_file(path) ? load_obj(path, vertices, block.indices) : mapMeshFile(path, block, vertices);
+    if (failed || block.view.header != nullptr)
+    {
+        block.failed = failed;
+        m_ready.push(std::move(block));
+        return;
+    }
+
+    if (m_optimize)
+    {
+        optimize_mesh(vertices, block.indices);
+    }
+
+    block.vertex_count = static_cast<uint32_t>(vertices.size());
+    if (m_compact)
+    {
+        std::vector<CompactVertex> compact;
+        quantize_vertices(vertices, compact);
+        block.vertices.resize(compact.size() * sizeof(CompactVertex));
+        memcpy(block.vertices.data(), compact.data(), block.vertices.size());
+    }
+    else
+    {
+        block.vertices.resize(vertices.size() * sizeof(Vertex));
+        memcpy(block.vertices.data(), vertices.data(), block.vertices.size());
+    }
+    m_ready.push(std::move(block));
+}
+
+StreamRequest AssetStreamer::request(const std::string& path)
+{
+    StreamRequest request = static_cast<StreamRequest>(m_requests.size());
+    m_requests.emplace_back();
+    m_loading++;
+    m_jobs->submit([this, request, path] { load(request, path); });
+    return request;
+}
+
+size_t AssetStreamer::update(MeshRegistry& meshes, size_t budget)
+{
+    TRACE_ZONE("stream update");
+    Block block;
+    while (m_ready.tryPop(block))
+    {
+        m_pending.push_back(std::move(block));
+    }
+
+    size_t uploaded = 0;
+    while (!m_pending.empty())
+    {
+        Block& next = m_pending.front();
+        const MeshFileHeader* header = next.view.header;
+        size_t size = next.vertices.size() + next.indices.size() * sizeof(uint32_t);
+        if (header != nullptr)
+        {
+            size = size_t(header->vertex_count) * header->vertex_stride + size_t(header->index_count) * header->index_size;
+        }
+        if (uploaded > 0 && uploaded + size > budget)
+        {
+            break;
+        }
+
+        Request& request = m_requests[next.request];
+        if (header != nullptr)
+        {
+            request.mesh = meshes.add(next.view.vertices, header->vertex_count, next.view.indices, header->index_count, next.view.getIndexType());
+            uploaded += size;
+        }
+        else if (!next.failed)
+        {
+            request.mesh = meshes.add(next.vertices.data(), next.vertex_count, next.indices);
+            uploaded += size;
+        }
+        request.state = request.mesh != INVALID_MESH ? StreamState::Ready : StreamState::Failed;
+        m_loading--;
+        m_pending.pop_front();
+    }
+    return uploaded;
+}
+
+StreamState AssetStreamer::getState(StreamRequest request)
+{
+    if (request >= m_requests.size())
+    {
+        return StreamState::Failed;
+    }
+    return m_requests[request].state;
+}
+
+MeshHandle AssetStreamer::getMesh(StreamRequest request)
+{
+    if (request >= m_requests.size())
+    {
+        return INVALID_MESH;
+    }
+    return m_requests[request].mesh;
+}
+
+uint32_t AssetStreamer::getLoadingCount()
+{
+    return m_loading;
+}
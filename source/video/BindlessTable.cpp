@@ -0,0 +1,209 @@
+#include "video/BindlessTable.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+BindlessTable::BindlessTable(VulkanContext& ctx, uint32_t buffer_capacity, uint32_t image_capacity) : m_ctx(ctx)
+{
+    // Update-after-bind arrays have their own limits, which may be lower
+    // than the regular per-stage ones
+    VkPhysicalDeviceVulkan12Properties properties_12 = {};
+    properties_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &properties_12;
+    ctx.inst_disp.getPhysicalDeviceProperties2(ctx.device.physical_device, &properties);
+
+    m_buffer_capacity = std::min({ buffer_capacity, properties_12.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+                                   properties_12.maxDescriptorSetUpdateAfterBindStorageBuffers });
+    m_image_capacity = std::min({ image_capacity, properties_12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                  properties_12.maxDescriptorSetUpdateAfterBindSampledImages });
+    // Both arrays and the sampler also share one resource budget per stage
+    uint32_t resources = std::min(properties_12.maxPerStageUpdateAfterBindResources, properties_12.maxUpdateAfterBindDescriptorsInAllPools);
+    if (resources == 0)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "device has no update-after-bind descriptors");
+        throw std::runtime_error("device has no update-after-bind descriptors");
+    }
+    m_buffer_capacity = std::min(m_buffer_capacity, resources - 1);
+    m_image_capacity = std::min(m_image_capacity, resources - 1 - m_buffer_capacity);
+
+    VkSamplerCreateInfo sampler_info = {};
+    sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_info.magFilter = VK_FILTER_LINEAR;
+    sampler_info.minFilter = VK_FILTER_LINEAR;
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+    if (ctx.disp.createSampler(&sampler_info, nullptr, &m_sampler) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create bindless sampler");
+        throw std::runtime_error("failed to create bindless sampler");
+    }
+
+    VkDescriptorSetLayoutBinding bindings[3] = {};
+    bindings[0].binding = STORAGE_BUFFER_BINDING;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[0].descriptorCount = m_buffer_capacity;
+    bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+
+    bindings[1].binding = SAMPLED_IMAGE_BINDING;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    bindings[1].descriptorCount = m_image_capacity;
+    bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+    bindings[2].binding = SAMPLER_BINDING;
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    bindings[2].descriptorCount = 1;
+    bindings[2].stageFlags = VK_SHADER_STAGE_ALL;
+    bindings[2].pImmutableSamplers = &m_sampler;
+
+    VkDescriptorBindingFlags array_flags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+    VkDescriptorBindingFlags binding_flags[3] = { array_flags, array_flags, 0 };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flags_info = {};
+    flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flags_info.bindingCount = 3;
+    flags_info.pBindingFlags = binding_flags;
+
+    VkDescriptorSetLayoutCreateInfo layout_info = {};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.pNext = &flags_info;
+    layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layout_info.bindingCount = 3;
+    layout_info.pBindings = bindings;
+    if (ctx.disp.createDescriptorSetLayout(&layout_info, nullptr, &m_layout) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create bindless descriptor set layout");
+        throw std::runtime_error("failed to create bindless descriptor set layout");
+    }
+
+    VkDescriptorPoolSize pool_sizes[3] = {};
+    pool_sizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_sizes[0].descriptorCount = m_buffer_capacity;
+    pool_sizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    pool_sizes[1].descriptorCount = m_image_capacity;
+    pool_sizes[2].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+    pool_sizes[2].descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    pool_info.maxSets = 1;
+    pool_info.poolSizeCount = 3;
+    pool_info.pPoolSizes = pool_sizes;
+    if (ctx.disp.createDescriptorPool(&pool_info, nullptr, &m_pool) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create bindless descriptor pool");
+        throw std::runtime_error("failed to create bindless descriptor pool");
+    }
+
+    VkDescriptorSetAllocateInfo alloc_info = {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool = m_pool;
+    alloc_info.descriptorSetCount = 1;
+    alloc_info.pSetLayouts = &m_layout;
+    if (ctx.disp.allocateDescriptorSets(&alloc_info, &m_set) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to allocate bindless descriptor set");
+        throw std::runtime_error("failed to allocate bindless descriptor set");
+    }
+}
+
+BindlessTable::~BindlessTable()
+{
+    m_ctx.disp.destroyDescriptorPool(m_pool, nullptr);
+    m_ctx.disp.destroyDescriptorSetLayout(m_layout, nullptr);
+    m_ctx.disp.destroySampler(m_sampler, nullptr);
+}
+
+VkDescriptorSetLayout BindlessTable::getLayout()
+{
+    return m_layout;
+}
+
+VkDescriptorSet BindlessTable::getSet()
+{
+    return m_set;
+}
+
+uint32_t BindlessTable::addStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    uint32_t index;
+    if (!m_free_buffers.empty())
+    {
+        index = m_free_buffers.back();
+        m_free_buffers.pop_back();
+    }
+    else if (m_buffer_count < m_buffer_capacity)
+    {
+        index = m_buffer_count++;
+    }
+    else
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "bindless table full, %u storage buffers", m_buffer_capacity);
+        return UINT32_MAX;
+    }
+
+    VkDescriptorBufferInfo buffer_info = {};
+    buffer_info.buffer = buffer;
+    buffer_info.offset = offset;
+    buffer_info.range = range;
+
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_set;
+    write.dstBinding = STORAGE_BUFFER_BINDING;
+    write.dstArrayElement = index;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.descriptorCount = 1;
+    write.pBufferInfo = &buffer_info;
+    m_ctx.disp.updateDescriptorSets(1, &write, 0, nullptr);
+    return index;
+}
+
+uint32_t BindlessTable::addSampledImage(VkImageView view, VkImageLayout layout)
+{
+    uint32_t index;
+    if (!m_free_images.empty())
+    {
+        index = m_free_images.back();
+        m_free_images.pop_back();
+    }
+    else if (m_image_count < m_image_capacity)
+    {
+        index = m_image_count++;
+    }
+    else
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "bindless table full, %u sampled images", m_image_capacity);
+        return UINT32_MAX;
+    }
+
+    VkDescriptorImageInfo image_info = {};
+    image_info.imageView = view;
+    image_info.imageLayout = layout;
+
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_set;
+    write.dstBinding = SAMPLED_IMAGE_BINDING;
+    write.dstArrayElement = index;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    write.descriptorCount = 1;
+    write.pImageInfo = &image_info;
+    m_ctx.disp.updateDescriptorSets(1, &write, 0, nullptr);
+    return index;
+}
+
+void BindlessTable::removeStorageBuffer(uint32_t index)
+{
+    m_free_buffers.push_back(index);
+}
+
+void BindlessTable::removeSampledImage(uint32_t index)
+{
+    m_free_images.push_back(index);
+}
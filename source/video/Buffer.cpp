@@ -1,6 +1,29 @@
 #include "video/Buffer.h"
 #include "video/VmaUsage.h"
 
+#include <algorithm>
+
+std::vector<uint32_t> Buffer::s_shared_queue_families;
+std::mutex Buffer::s_live_mutex;
+std::unordered_set<const Buffer*> Buffer::s_live_buffers;
+BufferTypeStats Buffer::s_type_stats[BUFFER_TYPE_COUNT];
+
+const char* buffer_type_name(BufferType type)
+{
+    switch (type)
+    {
+        case UniformBuffer: return "uniform";
+        case StagingBuffer: return "staging";
+        case VertexBuffer: return "vertex";
+        case IndiceBuffer: return "index";
+        case ReadbackBuffer: return "readback";
+        case StorageBuffer: return "storage";
+        case IndirectBuffer: return "indirect";
+        case InstanceBuffer: return "instance";
+        default: return "unknown";
+    }
+}
+
 Buffer::Buffer(BufferType type, uint32_t nb_elements, size_t size_element)
 {
     VmaAllocator& allocator = getAllocator();
@@ -8,6 +31,7 @@ Buffer::Buffer(BufferType type, uint32_t nb_elements, size_t size_element)
 
     m_bufferType = type;
     m_size = buffer_size;
+    m_element_size = size_element;
     m_number_elements = nb_elements;
 
     VkBufferCreateInfo buffer_create_info = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
@@ -30,8 +54,27 @@ Buffer::Buffer(BufferType type, uint32_t nb_elements, size_t size_element)
             buffer_create_info.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
             allocation_create_info.flags = 0;
             break;
+        case ReadbackBuffer:
+            buffer_create_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+            allocation_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+            break;
+        case StorageBuffer:
+            buffer_create_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+            allocation_create_info.flags = 0;
+            break;
+        case IndirectBuffer:
+            // Written by compute, cleared with fills, consumed by indirect draws
+            buffer_create_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+            allocation_create_info.flags = 0;
+            break;
+        case InstanceBuffer:
+            // Rewritten by the CPU every frame, read once per instance
+            buffer_create_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+            allocation_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+            break;
         case UniformBuffer:
-            buffer_create_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+            // Also readable as a storage buffer by bindless shaders
+            buffer_create_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
             allocation_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
             break;
         default:
@@ -40,6 +83,14 @@ Buffer::Buffer(BufferType type, uint32_t nb_elements, size_t size_element)
             break;
     }
 
+    bool transfer_destination = type == VertexBuffer || type == IndiceBuffer || type == StorageBuffer;
+    if (transfer_destination && s_shared_queue_families.size() > 1)
+    {
+        buffer_create_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        buffer_create_info.queueFamilyIndexCount = static_cast<uint32_t>(s_shared_queue_families.size());
+        buffer_create_info.pQueueFamilyIndices = s_shared_queue_families.data();
+    }
+
     // Staging buffer
     auto result = vmaCreateBuffer(allocator, &buffer_create_info, &allocation_create_info, &m_buffer, &m_allocation, &m_allocation_info);
     if (result != VK_SUCCESS)
@@ -47,12 +98,33 @@ Buffer::Buffer(BufferType type, uint32_t nb_elements, size_t size_element)
         SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create buffer");
         throw std::runtime_error("failed to create buffer");
     }
+    // Shows the type in detailed allocator stats
+    vmaSetAllocationName(allocator, m_allocation, buffer_type_name(type));
+
+    std::lock_guard<std::mutex> lock(s_live_mutex);
+    s_live_buffers.insert(this);
+    BufferTypeStats& stats = s_type_stats[type];
+    stats.live_count++;
+    stats.live_bytes += m_size;
+    stats.peak_bytes = std::max(stats.peak_bytes, stats.live_bytes);
+    stats.created_count++;
 }
 
 Buffer::~Buffer()
 {
     VmaAllocator& allocator = getAllocator();
     vmaDestroyBuffer(allocator, m_buffer, m_allocation);
+
+    std::lock_guard<std::mutex> lock(s_live_mutex);
+    s_live_buffers.erase(this);
+    BufferTypeStats& stats = s_type_stats[m_bufferType];
+    stats.live_count--;
+    stats.live_bytes -= m_size;
+}
+
+BufferType Buffer::getType()
+{
+    return m_bufferType;
 }
 
 size_t Buffer::getSize()
@@ -70,6 +142,11 @@ uint32_t Buffer::getNumberOfElements()
     return m_number_elements;
 }
 
+VkIndexType Buffer::getIndexType()
+{
+    return m_element_size == sizeof(uint32_t) ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+}
+
 bool Buffer::copyToStagingBuffer(const void *buffer, size_t size, VkDeviceSize offset)
 {
     VmaAllocator& allocator = getAllocator();
@@ -83,44 +160,37 @@ bool Buffer::copyToStagingBuffer(const void *buffer, size_t size, VkDeviceSize o
     
 }
 
-bool Buffer::copyTo(VulkanContext& ctx, Buffer& src, Buffer& dst)
+bool Buffer::copyFromReadbackBuffer(void *buffer, size_t size, VkDeviceSize offset)
 {
-    if (src.getSize() != dst.getSize())
+    VmaAllocator& allocator = getAllocator();
+    auto result = vmaCopyAllocationToMemory(allocator, m_allocation, offset, buffer, size);
+    if (result != VK_SUCCESS)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Tried to copy to a buffer of a different size");
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to copy from readback buffer");
         return true;
     }
-    
-
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = ctx.command_pool;
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(ctx.device.device, &allocInfo, &commandBuffer);
-
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-    VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = 0; // Optional
-    copyRegion.dstOffset = 0; // Optional
-    copyRegion.size = src.getSize();
-    vkCmdCopyBuffer(commandBuffer, src.m_buffer, dst.m_buffer, 1, &copyRegion);
-    vkEndCommandBuffer(commandBuffer);
+    return false;
+}
 
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
+void Buffer::setSharedQueueFamilies(const std::vector<uint32_t>& families)
+{
+    s_shared_queue_families = families;
+}
 
-    vkQueueSubmit(ctx.graphics_queue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(ctx.graphics_queue);
+BufferTypeStats Buffer::getTypeStats(BufferType type)
+{
+    std::lock_guard<std::mutex> lock(s_live_mutex);
+    return s_type_stats[type];
+}
 
-    vkFreeCommandBuffers(ctx.device.device, ctx.command_pool, 1, &commandBuffer);
-    return false;
+uint32_t Buffer::logLiveBuffers()
+{
+    std::lock_guard<std::mutex> lock(s_live_mutex);
+    for (const Buffer* buffer : s_live_buffers)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_VIDEO, "live %s buffer %p: %u elements of %zu bytes, %zu bytes",
+                    buffer_type_name(buffer->m_bufferType), static_cast<const void*>(buffer),
+                    buffer->m_number_elements, buffer->m_element_size, buffer->m_size);
+    }
+    return static_cast<uint32_t>(s_live_buffers.size());
 }
@@ -0,0 +1,289 @@
+#include "video/GpuCulling.h"
+
+#include <stdexcept>
+
+#include "video/ShaderLibrary.h"
+
+const uint32_t CULL_WORKGROUP_SIZE = 64;
+
+// Mirrors the push constants of cull.comp
+struct CullConstants {
+    glm::vec4 planes[6];
+    uint32_t object_count;
+    uint32_t index_count;
+    uint32_t frame;
+    uint32_t draw_offset;
+};
+
+GpuCulling::GpuCulling(VulkanContext& ctx, ShaderLibrary& shaders, VkPipelineCache cache,
+                       VkDescriptorSetLayout frame_layout, uint32_t max_objects, uint32_t frame_count)
+    : m_ctx(ctx), m_max_objects(max_objects), m_frame_count(frame_count)
+{
+    m_draws = new Buffer(BufferType::IndirectBuffer, m_frame_count * m_max_objects, sizeof(VkDrawIndexedIndirectCommand));
+    m_counts = new Buffer(BufferType::IndirectBuffer, m_frame_count, sizeof(uint32_t));
+
+    // objects, draws, counts
+    VkDescriptorSetLayoutBinding bindings[3] = {};
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    bindings[0].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layout_info = {};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = 3;
+    layout_info.pBindings = bindings;
+    if (ctx.disp.createDescriptorSetLayout(&layout_info, nullptr, &m_set_layout) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create culling descriptor set layout");
+        throw std::runtime_error("failed to create culling descriptor set layout");
+    }
+
+    VkDescriptorPoolSize pool_size = {};
+    pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_size.descriptorCount = 3 * m_frame_count;
+
+    VkDescriptorPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.maxSets = m_frame_count;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+    if (ctx.disp.createDescriptorPool(&pool_info, nullptr, &m_pool) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create culling descriptor pool");
+        throw std::runtime_error("failed to create culling descriptor pool");
+    }
+
+    std::vector<VkDescriptorSetLayout> set_layouts(m_frame_count, m_set_layout);
+    m_sets.resize(m_frame_count);
+    m_dirty.assign(m_frame_count, false);
+
+    VkDescriptorSetAllocateInfo alloc_info = {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool = m_pool;
+    alloc_info.descriptorSetCount = m_frame_count;
+    alloc_info.pSetLayouts = set_layouts.data();
+    if (ctx.disp.allocateDescriptorSets(&alloc_info, m_sets.data()) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to allocate culling descriptor sets");
+        throw std::runtime_error("failed to allocate culling descriptor sets");
+    }
+
+    VkPushConstantRange push_constant_range = {};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(CullConstants);
+
+    VkPipelineLayoutCreateInfo compute_layout_info = {};
+    compute_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    compute_layout_info.setLayoutCount = 1;
+    compute_layout_info.pSetLayouts = &m_set_layout;
+    compute_layout_info.pushConstantRangeCount = 1;
+    compute_layout_info.pPushConstantRanges = &push_constant_range;
+    if (ctx.disp.createPipelineLayout(&compute_layout_info, nullptr, &m_compute_layout) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create culling pipeline layout");
+        throw std::runtime_error("failed to create culling pipeline layout");
+    }
+
+    VkDescriptorSetLayout draw_set_layouts[] = { frame_layout, m_set_layout };
+    VkPipelineLayoutCreateInfo draw_layout_info = {};
+    draw_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    draw_layout_info.setLayoutCount = 2;
+    draw_layout_info.pSetLayouts = draw_set_layouts;
+    if (ctx.disp.createPipelineLayout(&draw_layout_info, nullptr, &m_draw_layout) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create indirect draw pipeline layout");
+        throw std::runtime_error("failed to create indirect draw pipeline layout");
+    }
+
+    // Built from shaders/src/cull.comp with the other shaders
+    VkShaderModule cull_module = shaders.getModule("cull.comp.spv");
+    if (cull_module == VK_NULL_HANDLE)
+    {
+        throw std::runtime_error("failed to load cull.comp.spv");
+    }
+
+    VkComputePipelineCreateInfo pipeline_info = {};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = cull_module;
+    pipeline_info.stage.pName = "main";
+    pipeline_info.layout = m_compute_layout;
+    if (ctx.disp.createComputePipelines(cache, 1, &pipeline_info, nullptr, &m_compute_pipeline) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create culling pipeline");
+        throw std::runtime_error("failed to create culling pipeline");
+    }
+}
+
+GpuCulling::~GpuCulling()
+{
+    m_ctx.disp.destroyPipeline(m_compute_pipeline, nullptr);
+    m_ctx.disp.destroyPipelineLayout(m_draw_layout, nullptr);
+    m_ctx.disp.destroyPipelineLayout(m_compute_layout, nullptr);
+    m_ctx.disp.destroyDescriptorPool(m_pool, nullptr);
+    m_ctx.disp.destroyDescriptorSetLayout(m_set_layout, nullptr);
+    delete m_objects;
+    delete m_draws;
+    delete m_counts;
+}
+
+VkPipelineLayout GpuCulling::getDrawLayout()
+{
+    return m_draw_layout;
+}
+
+uint32_t GpuCulling::getObjectCount()
+{
+    return m_object_count;
+}
+
+bool GpuCulling::setObjects(UploadManager& uploads, const std::vector<GpuObject>& objects, Buffer*& retired, UploadTicket* ticket)
+{
+    retired = nullptr;
+    if (objects.size() > m_max_objects)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "%zu objects, culling was created for %u", objects.size(), m_max_objects);
+        return true;
+    }
+    if (objects.empty())
+    {
+        m_object_count = 0;
+        return false;
+    }
+
+    Buffer* buffer;
+    try
+    {
+        buffer = new Buffer(BufferType::StorageBuffer, static_cast<uint32_t>(objects.size()), sizeof(GpuObject));
+    }
+    catch(const std::runtime_error& e)
+    {
+        return true;
+    }
+
+    UploadTicket upload_ticket = uploads.upload(objects.data(), buffer->getSize(), buffer->getBuffer());
+    if (upload_ticket == 0)
+    {
+        delete buffer;
+        return true;
+    }
+    if (ticket != nullptr)
+    {
+        *ticket = upload_ticket;
+    }
+
+    // Every frame's set is rewritten the next time that frame records,
+    // when the GPU is done with its previous use
+    retired = m_objects;
+    m_objects = buffer;
+    m_object_count = static_cast<uint32_t>(objects.size());
+    m_dirty.assign(m_frame_count, true);
+    return false;
+}
+
+void GpuCulling::writeSet(uint32_t frame)
+{
+    VkDescriptorBufferInfo buffer_infos[3] = {};
+    buffer_infos[0].buffer = m_objects->getBuffer();
+    buffer_infos[0].offset = 0;
+    buffer_infos[0].range = VK_WHOLE_SIZE;
+    buffer_infos[1].buffer = m_draws->getBuffer();
+    buffer_infos[1].offset = 0;
+    buffer_infos[1].range = VK_WHOLE_SIZE;
+    buffer_infos[2].buffer = m_counts->getBuffer();
+    buffer_infos[2].offset = 0;
+    buffer_infos[2].range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet writes[3] = {};
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_sets[frame];
+        writes[i].dstBinding = i;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].descriptorCount = 1;
+        writes[i].pBufferInfo = &buffer_infos[i];
+    }
+    m_ctx.disp.updateDescriptorSets(3, writes, 0, nullptr);
+    m_dirty[frame] = false;
+}
+
+// Gribb-Hartmann planes of the clip volume, normals pointing inwards
+void extract_frustum_planes(const glm::mat4& m, glm::vec4 planes[6])
+{
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    // OpenGL style near plane, conservative for a [0, 1] depth range
+    planes[4] = row3 + row2;
+    planes[5] = row3 - row2;
+
+    for (int i = 0; i < 6; i++)
+    {
+        float length = glm::length(glm::vec3(planes[i]));
+        if (length > 0.0f)
+        {
+            planes[i] /= length;
+        }
+    }
+}
+
+void GpuCulling::recordCull(VkCommandBuffer command_buffer, uint32_t frame, const glm::mat4& view_proj, uint32_t index_count)
+{
+    if (m_dirty[frame])
+    {
+        writeSet(frame);
+    }
+
+    m_ctx.disp.cmdFillBuffer(command_buffer, m_counts->getBuffer(), frame * sizeof(uint32_t), sizeof(uint32_t), 0);
+
+    // The slice's previous reader, this frame's last indirect draw, is
+    // already covered by the frame fence
+    VkMemoryBarrier fill_barrier = {};
+    fill_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    fill_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    fill_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    m_ctx.disp.cmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                  0, 1, &fill_barrier, 0, nullptr, 0, nullptr);
+
+    CullConstants constants = {};
+    extract_frustum_planes(view_proj, constants.planes);
+    constants.object_count = m_object_count;
+    constants.index_count = index_count;
+    constants.frame = frame;
+    constants.draw_offset = frame * m_max_objects;
+
+    m_ctx.disp.cmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_compute_pipeline);
+    m_ctx.disp.cmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_compute_layout, 0, 1, &m_sets[frame], 0, nullptr);
+    m_ctx.disp.cmdPushConstants(command_buffer, m_compute_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    m_ctx.disp.cmdDispatch(command_buffer, (m_object_count + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+
+    VkMemoryBarrier cull_barrier = {};
+    cull_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cull_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cull_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    m_ctx.disp.cmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                                  0, 1, &cull_barrier, 0, nullptr, 0, nullptr);
+}
+
+void GpuCulling::recordDraw(VkCommandBuffer command_buffer, uint32_t frame)
+{
+    m_ctx.disp.cmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_draw_layout, 1, 1, &m_sets[frame], 0, nullptr);
+    m_ctx.disp.cmdDrawIndexedIndirectCount(command_buffer,
+                                           m_draws->getBuffer(), frame * m_max_objects * sizeof(VkDrawIndexedIndirectCommand),
+                                           m_counts->getBuffer(), frame * sizeof(uint32_t),
+                                           m_object_count, sizeof(VkDrawIndexedIndirectCommand));
+}
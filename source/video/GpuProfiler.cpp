@@ -0,0 +1,191 @@
+#include "video/GpuProfiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+GpuProfiler::GpuProfiler(VulkanContext& ctx, uint32_t frame_count, uint32_t max_scopes, uint32_t window)
+    : m_ctx(ctx), m_max_queries(max_scopes * 2), m_window(std::max(1u, window))
+{
+    const VkPhysicalDeviceLimits& limits = ctx.device.physical_device.properties.limits;
+    uint32_t family = ctx.device.get_queue_index(vkb::QueueType::graphics).value();
+    uint32_t valid_bits = ctx.device.queue_families[family].timestampValidBits;
+    if (valid_bits == 0 || limits.timestampPeriod == 0.0f)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "graphics queue does not support timestamps");
+        throw std::runtime_error("graphics queue does not support timestamps");
+    }
+    m_period = limits.timestampPeriod;
+    m_valid_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+
+    VkQueryPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    pool_info.queryCount = m_max_queries;
+
+    m_frames.resize(frame_count);
+    for (Frame& frame : m_frames)
+    {
+        if (ctx.disp.createQueryPool(&pool_info, nullptr, &frame.pool) != VK_SUCCESS)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create timestamp query pool");
+            throw std::runtime_error("failed to create timestamp query pool");
+        }
+    }
+    m_results.resize(m_max_queries);
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    for (Frame& frame : m_frames)
+    {
+        m_ctx.disp.destroyQueryPool(frame.pool, nullptr);
+    }
+}
+
+GpuScope GpuProfiler::getScope(const std::string& name)
+{
+    auto it = m_names.find(name);
+    if (it != m_names.end())
+    {
+        return it->second;
+    }
+
+    GpuScope scope = static_cast<GpuScope>(m_scopes.size());
+    m_scopes.emplace_back();
+    m_scopes.back().stats.name = name;
+    m_scopes.back().history.reserve(m_window);
+    m_names[name] = scope;
+    return scope;
+}
+
+void GpuProfiler::addSample(Scope& scope, double ms)
+{
+    if (scope.history.size() < m_window)
+    {
+        scope.history.push_back(ms);
+    }
+    else
+    {
+        scope.history[scope.next_sample] = ms;
+    }
+    scope.next_sample = (scope.next_sample + 1) % m_window;
+
+    double sum = 0.0;
+    double max = 0.0;
+    for (double sample : scope.history)
+    {
+        sum += sample;
+        max = std::max(max, sample);
+    }
+    scope.stats.last = ms;
+    scope.stats.average = sum / scope.history.size();
+    scope.stats.max = max;
+    scope.stats.samples++;
+}
+
+// Only called once the frame's fence signaled, so the results are available
+// and no wait flag is needed
+void GpuProfiler::collect(Frame& frame)
+{
+    if (frame.written.empty())
+    {
+        return;
+    }
+
+    VkResult result = m_ctx.disp.getQueryPoolResults(frame.pool, 0, frame.query_count, frame.query_count * sizeof(uint64_t),
+                                                      m_results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS)
+    {
+        // VK_NOT_READY if the frame was never submitted, its samples are dropped
+        return;
+    }
+
+    for (const Written& written : frame.written)
+    {
+        uint64_t ticks = (m_results[written.end_query] - m_results[written.begin_query]) & m_valid_mask;
+        addSample(m_scopes[written.scope], ticks * m_period / 1000000.0);
+    }
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer command_buffer, uint32_t frame)
+{
+    m_current = frame;
+    Frame& current = m_frames[frame];
+    collect(current);
+    current.written.clear();
+    current.query_count = 0;
+    m_open.clear();
+    m_ctx.disp.cmdResetQueryPool(command_buffer, current.pool, 0, m_max_queries);
+}
+
+void GpuProfiler::endFrame(VkCommandBuffer command_buffer)
+{
+    while (!m_open.empty())
+    {
+        endScope(command_buffer);
+    }
+}
+
+void GpuProfiler::beginScope(VkCommandBuffer command_buffer, GpuScope scope)
+{
+    Frame& frame = m_frames[m_current];
+    if (scope >= m_scopes.size() || frame.query_count + 2 > m_max_queries)
+    {
+        // Still pushed so the matching endScope pops it
+        m_open.push_back(UINT32_MAX);
+        return;
+    }
+
+    Written written = { scope, frame.query_count, frame.query_count + 1 };
+    frame.query_count += 2;
+    m_ctx.disp.cmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.pool, written.begin_query);
+    m_open.push_back(static_cast<uint32_t>(frame.written.size()));
+    frame.written.push_back(written);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer command_buffer)
+{
+    if (m_open.empty())
+    {
+        return;
+    }
+    uint32_t index = m_open.back();
+    m_open.pop_back();
+    if (index == UINT32_MAX)
+    {
+        return;
+    }
+
+    Frame& frame = m_frames[m_current];
+    m_ctx.disp.cmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.pool, frame.written[index].end_query);
+}
+
+uint32_t GpuProfiler::getWindow() const
+{
+    return m_window;
+}
+
+const std::vector<GpuScopeStats>& GpuProfiler::getStats()
+{
+    m_stats.clear();
+    for (const Scope& scope : m_scopes)
+    {
+        m_stats.push_back(scope.stats);
+    }
+    return m_stats;
+}
+
+const GpuScopeStats& GpuProfiler::getScopeStats(GpuScope scope) const
+{
+    return m_scopes[scope].stats;
+}
+
+double GpuProfiler::getAverage(const std::string& name)
+{
+    auto it = m_names.find(name);
+    if (it == m_names.end())
+    {
+        return 0.0;
+    }
+    return m_scopes[it->second].stats.average;
+}
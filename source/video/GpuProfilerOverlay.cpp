@@ -0,0 +1,43 @@
+#include "video/GpuProfilerOverlay.h"
+
+#include <imgui.h>
+
+#include "video/GpuProfiler.h"
+
+void draw_gpu_profiler_overlay(GpuProfiler& profiler, bool* open)
+{
+    ImGui::SetNextWindowBgAlpha(0.6f);
+    if (!ImGui::Begin("GPU timings", open, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing))
+    {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Text("averaged over %u frames", profiler.getWindow());
+    if (ImGui::BeginTable("scopes", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+    {
+        ImGui::TableSetupColumn("scope");
+        ImGui::TableSetupColumn("last ms");
+        ImGui::TableSetupColumn("avg ms");
+        ImGui::TableSetupColumn("max ms");
+        ImGui::TableHeadersRow();
+        for (const GpuScopeStats& stats : profiler.getStats())
+        {
+            if (stats.samples == 0)
+            {
+                continue;
+            }
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(stats.name.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.last);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.average);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.max);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
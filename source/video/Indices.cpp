@@ -0,0 +1,23 @@
+#include "video/Indices.h"
+
+#include <algorithm>
+
+uint32_t max_index(const std::vector<uint32_t>& indices)
+{
+    if (indices.empty())
+    {
+        return 0;
+    }
+    return *std::max_element(indices.begin(), indices.end());
+}
+
+bool narrow_indices(const std::vector<uint32_t>& indices, std::vector<uint16_t>& narrowed)
+{
+    narrowed.clear();
+    if (max_index(indices) > MAX_INDEX_UINT16)
+    {
+        return false;
+    }
+    narrowed.assign(indices.begin(), indices.end());
+    return true;
+}
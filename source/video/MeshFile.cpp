@@ -0,0 +1,144 @@
+#include "video/MeshFile.h"
+
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <fstream>
+
+#include "video/Indices.h"
+
+static uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+VkIndexType MeshFileView::getIndexType() const
+{
+    return header->index_size == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+template<typename T>
+static uint32_t max_blob_index(const void* indices, uint32_t index_count)
+{
+    const T* values = static_cast<const T*>(indices);
+    uint32_t max = 0;
+    for (uint32_t i = 0; i < index_count; i++)
+    {
+        max = std::max<uint32_t>(max, values[i]);
+    }
+    return max;
+}
+
+bool read_mesh_file(const void* data, size_t size, MeshFileView& view, uint32_t max_index_value)
+{
+    if (size < sizeof(MeshFileHeader))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "mesh file too small for its header");
+        return true;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    const MeshFileHeader* header = reinterpret_cast<const MeshFileHeader*>(bytes);
+    if (header->magic != MESH_FILE_MAGIC || header->version != MESH_FILE_VERSION)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "not a version %u mesh file", MESH_FILE_VERSION);
+        return true;
+    }
+    if (header->attribute_count == 0 || header->attribute_count > MESH_FILE_MAX_ATTRIBUTES ||
+        header->vertex_stride == 0 || (header->index_size != sizeof(uint16_t) && header->index_size != sizeof(uint32_t)) ||
+        header->vertex_offset % MESH_FILE_ALIGNMENT != 0 || header->index_offset % MESH_FILE_ALIGNMENT != 0)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "corrupt mesh file header");
+        return true;
+    }
+
+    // 64 bit sums cannot overflow with 32 bit counts and strides
+    uint64_t attributes_end = sizeof(MeshFileHeader) + uint64_t(header->attribute_count) * sizeof(MeshFileAttribute);
+    uint64_t vertices_end = header->vertex_offset + uint64_t(header->vertex_count) * header->vertex_stride;
+    uint64_t indices_end = header->index_offset + uint64_t(header->index_count) * header->index_size;
+    if (header->vertex_offset < attributes_end || vertices_end > size || header->index_offset < attributes_end || indices_end > size ||
+        header->vertex_offset > size || header->index_offset > size)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "mesh file truncated, %zu bytes", size);
+        return true;
+    }
+
+    // The blob goes to the GPU as is, an index past the vertices would read
+    // outside the mesh's range of the shared vertex buffer
+    const void* indices = bytes + header->index_offset;
+    if (header->index_count > 0)
+    {
+        uint32_t max = header->index_size == sizeof(uint16_t) ? max_blob_index<uint16_t>(indices, header->index_count)
+                                                                   : max_blob_index<uint32_t>(indices, header->index_count);
+        if (max >= header->vertex_count)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "mesh file index %u out of range for %u vertices", max, header->vertex_count);
+            return true;
+        }
+        if (header->index_size == sizeof(uint32_t) && max > max_index_value)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "index %u above the device limit %u", max, max_index_value);
+            return true;
+        }
+    }
+
+    view.header = header;
+    view.attributes = reinterpret_cast<const MeshFileAttribute*>(bytes + sizeof(MeshFileHeader));
+    view.vertices = bytes + header->vertex_offset;
+    view.indices = indices;
+    return false;
+}
+
+bool write_mesh_file(const std::string& path, const std::vector<MeshFileAttribute>& attributes, uint32_t vertex_stride,
+                     const void* vertices, uint32_t vertex_count, const std::vector<uint32_t>& indices)
+{
+    if (attributes.empty() || attributes.size() > MESH_FILE_MAX_ATTRIBUTES)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "mesh files hold 1 to %u attributes", MESH_FILE_MAX_ATTRIBUTES);
+        return true;
+    }
+
+    std::vector<uint16_t> narrowed;
+    bool narrow = narrow_indices(indices, narrowed);
+
+    MeshFileHeader header;
+    header.vertex_stride = vertex_stride;
+    header.attribute_count = static_cast<uint32_t>(attributes.size());
+    header.vertex_count = vertex_count;
+    header.index_count = static_cast<uint32_t>(indices.size());
+    header.index_size = narrow ? sizeof(uint16_t) : sizeof(uint32_t);
+    header.vertex_offset = align_up(sizeof(MeshFileHeader) + attributes.size() * sizeof(MeshFileAttribute), MESH_FILE_ALIGNMENT);
+    uint64_t vertex_size = uint64_t(vertex_count) * vertex_stride;
+    header.index_offset = align_up(header.vertex_offset + vertex_size, MESH_FILE_ALIGNMENT);
+    uint64_t index_size = uint64_t(header.index_count) * header.index_size;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to open %s", path.c_str());
+        return true;
+    }
+
+    // Zero padding up to each aligned offset
+    const char padding[MESH_FILE_ALIGNMENT] = {};
+    uint64_t written = sizeof(MeshFileHeader) + attributes.size() * sizeof(MeshFileAttribute);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(attributes.data()), attributes.size() * sizeof(MeshFileAttribute));
+    file.write(padding, header.vertex_offset - written);
+    file.write(static_cast<const char*>(vertices), vertex_size);
+    file.write(padding, header.index_offset - header.vertex_offset - vertex_size);
+    if (narrow)
+    {
+        file.write(reinterpret_cast<const char*>(narrowed.data()), index_size);
+    }
+    else
+    {
+        file.write(reinterpret_cast<const char*>(indices.data()), index_size);
+    }
+
+    if (!file.good())
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to write %s", path.c_str());
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,280 @@
+#include "video/MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Simulated hardware cache, FIFO replacement tracked with timestamps
+struct FifoCache {
+    std::vector<uint32_t> timestamps;
+    uint32_t size;
+    uint32_t time;
+
+    FifoCache(uint32_t vertex_count, uint32_t cache_size)
+        : timestamps(vertex_count, 0), size(cache_size), time(cache_size + 1)
+    {
+    }
+
+    // 1 when the vertex had to be transformed
+    uint32_t access(uint32_t vertex)
+    {
+        if (time - timestamps[vertex] > size)
+        {
+            timestamps[vertex] = time++;
+            return 1;
+        }
+        return 0;
+    }
+};
+
+uint32_t hash_vertex(const Vertex& vertex)
+{
+    // FNV-1a over the raw bytes, Vertex has no padding
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertex);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(Vertex); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void deduplicate_vertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    if (indices.empty())
+    {
+        indices.resize(vertices.size());
+        for (uint32_t i = 0; i < indices.size(); i++)
+        {
+            indices[i] = i;
+        }
+    }
+
+    // Open addressing table of indices into unique, at most half full
+    size_t table_size = 1;
+    while (table_size < vertices.size() * 2)
+    {
+        table_size *= 2;
+    }
+    std::vector<uint32_t> table(table_size, UINT32_MAX);
+
+    std::vector<Vertex> unique;
+    std::vector<uint32_t> remap(vertices.size());
+    for (size_t v = 0; v < vertices.size(); v++)
+    {
+        size_t slot = hash_vertex(vertices[v]) & (table_size - 1);
+        while (table[slot] != UINT32_MAX && memcmp(&unique[table[slot]], &vertices[v], sizeof(Vertex)) != 0)
+        {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        if (table[slot] == UINT32_MAX)
+        {
+            table[slot] = static_cast<uint32_t>(unique.size());
+            unique.push_back(vertices[v]);
+        }
+        remap[v] = table[slot];
+    }
+
+    for (uint32_t& index : indices)
+    {
+        index = remap[index];
+    }
+    vertices.swap(unique);
+}
+
+const uint32_t FORSYTH_CACHE_SIZE = 32;
+
+// Forsyth's vertex score: recently used vertices score high, except the
+// last triangle's so strips do not repeat, and vertices with few
+// triangles left get a boost so they are finished off
+float forsyth_vertex_score(int cache_position, uint32_t live_triangles)
+{
+    if (live_triangles == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cache_position >= 0)
+    {
+        if (cache_position < 3)
+        {
+            score = 0.75f;
+        }
+        else
+        {
+            float scaled = 1.0f - float(cache_position - 3) / (FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(scaled, 1.5f);
+        }
+    }
+    return score + 2.0f / std::sqrt(float(live_triangles));
+}
+
+void optimize_vertex_cache(std::vector<uint32_t>& indices, uint32_t vertex_count)
+{
+    size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0)
+    {
+        return;
+    }
+
+    // Triangles of each vertex, live ones first in [offsets[v], offsets[v] + live[v])
+    std::vector<uint32_t> live(vertex_count, 0);
+    for (uint32_t index : indices)
+    {
+        live[index]++;
+    }
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for (uint32_t v = 0; v < vertex_count; v++)
+    {
+        offsets[v + 1] = offsets[v] + live[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangle_count; t++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<float> vertex_scores(vertex_count);
+    for (uint32_t v = 0; v < vertex_count; v++)
+    {
+        vertex_scores[v] = forsyth_vertex_score(-1, live[v]);
+    }
+
+    std::vector<float> triangle_scores(triangle_count);
+    std::vector<bool> emitted(triangle_count, false);
+    uint32_t best = 0;
+    for (size_t t = 0; t < triangle_count; t++)
+    {
+        const uint32_t* tri = &indices[t * 3];
+        triangle_scores[t] = vertex_scores[tri[0]] + vertex_scores[tri[1]] + vertex_scores[tri[2]];
+        if (triangle_scores[t] > triangle_scores[best])
+        {
+            best = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> next_cache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    next_cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    size_t cursor = 0;
+
+    for (size_t emitted_count = 0; emitted_count < triangle_count; emitted_count++)
+    {
+        if (best == UINT32_MAX)
+        {
+            // Nothing adjacent to the cache left, continue in input order
+            while (emitted[cursor])
+            {
+                cursor++;
+            }
+            best = static_cast<uint32_t>(cursor);
+        }
+
+        const uint32_t* tri = &indices[best * 3];
+        emitted[best] = true;
+        next_cache.clear();
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t v = tri[k];
+            result.push_back(v);
+            next_cache.push_back(v);
+
+            // Move the triangle past the vertex's live ones
+            uint32_t* begin = &adjacency[offsets[v]];
+            uint32_t* last = begin + live[v] - 1;
+            *std::find(begin, last + 1, best) = *last;
+            *last = best;
+            live[v]--;
+        }
+        for (uint32_t v : cache)
+        {
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+            {
+                next_cache.push_back(v);
+            }
+        }
+
+        // Evicted vertices are rescored too, they lost their cache bonus
+        for (size_t i = 0; i < next_cache.size(); i++)
+        {
+            int position = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+            vertex_scores[next_cache[i]] = forsyth_vertex_score(position, live[next_cache[i]]);
+        }
+
+        best = UINT32_MAX;
+        float best_score = -1.0f;
+        for (uint32_t v : next_cache)
+        {
+            for (uint32_t i = offsets[v]; i < offsets[v] + live[v]; i++)
+            {
+                uint32_t t = adjacency[i];
+                const uint32_t* other = &indices[t * 3];
+                triangle_scores[t] = vertex_scores[other[0]] + vertex_scores[other[1]] + vertex_scores[other[2]];
+                if (triangle_scores[t] > best_score)
+                {
+                    best_score = triangle_scores[t];
+                    best = t;
+                }
+            }
+        }
+
+        if (next_cache.size() > FORSYTH_CACHE_SIZE)
+        {
+            next_cache.resize(FORSYTH_CACHE_SIZE);
+        }
+        cache.swap(next_cache);
+    }
+
+    indices.swap(result);
+}
+
+float average_cache_miss_ratio(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size)
+{
+    size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0)
+    {
+        return 0.0f;
+    }
+
+    FifoCache cache(vertex_count, cache_size);
+    uint32_t misses = 0;
+    for (size_t i = 0; i < triangle_count * 3; i++)
+    {
+        misses += cache.access(indices[i]);
+    }
+    return float(misses) / triangle_count;
+}
+
+std::vector<uint32_t> optimize_vertex_fetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+    for (uint32_t& index : indices)
+    {
+        if (remap[index] == UINT32_MAX)
+        {
+            remap[index] = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(reordered);
+    return remap;
+}
+
+void optimize_mesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    deduplicate_vertices(vertices, indices);
+    optimize_vertex_cache(indices, static_cast<uint32_t>(vertices.size()));
+    optimize_vertex_fetch(vertices, indices);
+}
@@ -0,0 +1,216 @@
+#include "video/MeshRegistry.h"
+
+#include <stdexcept>
+
+#include "video/Indices.h"
+
+MeshRegistry::MeshRegistry(UploadManager& uploads, uint32_t vertex_capacity, uint32_t index_capacity, size_t vertex_stride)
+    : m_uploads(uploads), m_index_capacity(index_capacity), m_vertex_stride(vertex_stride)
+{
+    m_vertices = new Buffer(BufferType::VertexBuffer, vertex_capacity, vertex_stride);
+    m_indices = new Buffer(BufferType::IndiceBuffer, index_capacity, sizeof(uint16_t));
+
+    // The blocks only hand out offsets, their unit is one vertex or one index
+    VmaVirtualBlockCreateInfo block_info = {};
+    block_info.size = vertex_capacity;
+    if (vmaCreateVirtualBlock(&block_info, &m_vertex_block) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create mesh vertex block");
+        throw std::runtime_error("failed to create mesh vertex block");
+    }
+    block_info.size = index_capacity;
+    if (vmaCreateVirtualBlock(&block_info, &m_index_block) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create mesh index block");
+        throw std::runtime_error("failed to create mesh index block");
+    }
+}
+
+MeshRegistry::~MeshRegistry()
+{
+    VmaVirtualBlock blocks[] = { m_vertex_block, m_index_block, m_wide_index_block };
+    for (VmaVirtualBlock block : blocks)
+    {
+        if (block != VK_NULL_HANDLE)
+        {
+            vmaClearVirtualBlock(block);
+            vmaDestroyVirtualBlock(block);
+        }
+    }
+    delete m_vertices;
+    delete m_indices;
+    delete m_wide_indices;
+}
+
+VmaVirtualBlock MeshRegistry::getIndexBlock(VkIndexType index_type)
+{
+    if (index_type == VK_INDEX_TYPE_UINT16)
+    {
+        return m_index_block;
+    }
+    if (m_wide_index_block != VK_NULL_HANDLE)
+    {
+        return m_wide_index_block;
+    }
+
+    // Same capacity in indices as the 16 bit buffer
+    try
+    {
+        m_wide_indices = new Buffer(BufferType::IndiceBuffer, m_index_capacity, sizeof(uint32_t));
+    }
+    catch(const std::runtime_error& e)
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    VmaVirtualBlockCreateInfo block_info = {};
+    block_info.size = m_index_capacity;
+    if (vmaCreateVirtualBlock(&block_info, &m_wide_index_block) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create mesh 32 bit index block");
+        delete m_wide_indices;
+        m_wide_indices = nullptr;
+        return VK_NULL_HANDLE;
+    }
+    return m_wide_index_block;
+}
+
+MeshHandle MeshRegistry::add(const void* vertices, uint32_t vertex_count, const std::vector<uint16_t>& indices, UploadTicket* ticket)
+{
+    return addMesh(vertices, vertex_count, indices.data(), static_cast<uint32_t>(indices.size()), VK_INDEX_TYPE_UINT16, ticket);
+}
+
+MeshHandle MeshRegistry::add(const void* vertices, uint32_t vertex_count, const std::vector<uint32_t>& indices, UploadTicket* ticket)
+{
+    std::vector<uint16_t> narrowed;
+    if (narrow_indices(indices, narrowed))
+    {
+        return add(vertices, vertex_count, narrowed, ticket);
+    }
+    return addMesh(vertices, vertex_count, indices.data(), static_cast<uint32_t>(indices.size()), VK_INDEX_TYPE_UINT32, ticket);
+}
+
+MeshHandle MeshRegistry::add(const void* vertices, uint32_t vertex_count, const void* indices, uint32_t index_count,
+                             VkIndexType index_type, UploadTicket* ticket)
+{
+    return addMesh(vertices, vertex_count, indices, index_count, index_type, ticket);
+}
+
+MeshHandle MeshRegistry::addMesh(const void* vertices, uint32_t vertex_count, const void* indices, uint32_t index_count,
+                                 VkIndexType index_type, UploadTicket* ticket)
+{
+    if (vertex_count == 0 || index_count == 0)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "empty mesh");
+        return INVALID_MESH;
+    }
+
+    VmaVirtualBlock index_block = getIndexBlock(index_type);
+    if (index_block == VK_NULL_HANDLE)
+    {
+        return INVALID_MESH;
+    }
+    Buffer* index_buffer = index_type == VK_INDEX_TYPE_UINT16 ? m_indices : m_wide_indices;
+    size_t index_size = index_type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    Entry entry;
+    VkDeviceSize vertex_offset = 0;
+    VkDeviceSize first_index = 0;
+
+    VmaVirtualAllocationCreateInfo allocation_info = {};
+    allocation_info.size = vertex_count;
+    if (vmaVirtualAllocate(m_vertex_block, &allocation_info, &entry.vertex_allocation, &vertex_offset) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "mesh vertex buffer full, %u vertices requested", vertex_count);
+        return INVALID_MESH;
+    }
+    allocation_info.size = index_count;
+    if (vmaVirtualAllocate(index_block, &allocation_info, &entry.index_allocation, &first_index) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "mesh index buffer full, %u indices requested", index_count);
+        vmaVirtualFree(m_vertex_block, entry.vertex_allocation);
+        return INVALID_MESH;
+    }
+
+    // Both copies land in the open batch, they share its ticket
+    UploadTicket upload_ticket = m_uploads.upload(vertices, vertex_count * m_vertex_stride, m_vertices->getBuffer(), vertex_offset * m_vertex_stride);
+    if (upload_ticket != 0)
+    {
+        upload_ticket = m_uploads.upload(indices, index_count * index_size, index_buffer->getBuffer(), first_index * index_size);
+    }
+    if (upload_ticket == 0)
+    {
+        vmaVirtualFree(m_vertex_block, entry.vertex_allocation);
+        vmaVirtualFree(index_block, entry.index_allocation);
+        return INVALID_MESH;
+    }
+    if (ticket != nullptr)
+    {
+        *ticket = upload_ticket;
+    }
+
+    entry.range.vertex_offset = static_cast<int32_t>(vertex_offset);
+    entry.range.first_index = static_cast<uint32_t>(first_index);
+    entry.range.index_count = index_count;
+    entry.range.vertex_count = vertex_count;
+    entry.range.index_type = index_type;
+    entry.live = true;
+
+    MeshHandle mesh;
+    if (!m_free_handles.empty())
+    {
+        mesh = m_free_handles.back();
+        m_free_handles.pop_back();
+        m_entries[mesh] = entry;
+    }
+    else
+    {
+        mesh = static_cast<MeshHandle>(m_entries.size());
+        m_entries.push_back(entry);
+    }
+    m_mesh_count++;
+    return mesh;
+}
+
+void MeshRegistry::remove(MeshHandle mesh)
+{
+    if (!isValid(mesh))
+    {
+        return;
+    }
+    Entry& entry = m_entries[mesh];
+    vmaVirtualFree(m_vertex_block, entry.vertex_allocation);
+    vmaVirtualFree(getIndexBlock(entry.range.index_type), entry.index_allocation);
+    entry = Entry();
+    m_free_handles.push_back(mesh);
+    m_mesh_count--;
+}
+
+bool MeshRegistry::isValid(MeshHandle mesh)
+{
+    return mesh < m_entries.size() && m_entries[mesh].live;
+}
+
+const MeshRange& MeshRegistry::getRange(MeshHandle mesh)
+{
+    return m_entries[mesh].range;
+}
+
+uint32_t MeshRegistry::getMeshCount()
+{
+    return m_mesh_count;
+}
+
+VkBuffer& MeshRegistry::getVertexBuffer()
+{
+    return m_vertices->getBuffer();
+}
+
+VkBuffer MeshRegistry::getIndexBuffer(VkIndexType index_type)
+{
+    if (index_type == VK_INDEX_TYPE_UINT16)
+    {
+        return m_indices->getBuffer();
+    }
+    return m_wide_indices != nullptr ? m_wide_indices->getBuffer() : VK_NULL_HANDLE;
+}
@@ -0,0 +1,162 @@
+#include "video/ObjLoader.h"
+
+#include <SDL3/SDL.h>
+
+#include <cstdlib>
+#include <stdexcept>
+
+#include "core/MappedFile.h"
+
+// Resolves an OBJ index, 1 based or negative relative to the end, into a
+// 0 based vertex index. Returns true if it is out of range
+static bool resolve_index(long index, size_t vertex_count, uint32_t& resolved)
+{
+    long count = static_cast<long>(vertex_count);
+    if (index < 0)
+    {
+        index += count;
+    }
+    else
+    {
+        index -= 1;
+    }
+    if (index < 0 || index >= count)
+    {
+        return true;
+    }
+    resolved = static_cast<uint32_t>(index);
+    return false;
+}
+
+// Parses one line, held in a null terminated copy so strtof cannot run past it
+static bool parse_line(const char* line, uint32_t line_number, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const std::string& path)
+{
+    while (*line == ' ' || *line == '\t')
+    {
+        line++;
+    }
+
+    if (line[0] == 'v' && (line[1] == ' ' || line[1] == '\t'))
+    {
+        const char* cursor = line + 2;
+        float values[6] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+        int count = 0;
+        while (count < 6)
+        {
+            char* end = nullptr;
+            float value = strtof(cursor, &end);
+            if (end == cursor)
+            {
+                break;
+            }
+            values[count++] = value;
+            cursor = end;
+        }
+        if (count < 3)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "%s:%u: vertex needs three coordinates", path.c_str(), line_number);
+            return true;
+        }
+        // Without the color extension a fourth value is the w coordinate, not red
+        if (count < 6)
+        {
+            values[3] = values[4] = values[5] = 1.0f;
+        }
+
+        Vertex vertex;
+        vertex.pos = glm::vec2(values[0], values[1]);
+        vertex.color = glm::vec3(values[3], values[4], values[5]);
+        vertices.push_back(vertex);
+    }
+    else if (line[0] == 'f' && (line[1] == ' ' || line[1] == '\t'))
+    {
+        const char* cursor = line + 2;
+        uint32_t first = 0;
+        uint32_t previous = 0;
+        uint32_t corners = 0;
+        while (true)
+        {
+            char* end = nullptr;
+            long index = strtol(cursor, &end, 10);
+            if (end == cursor)
+            {
+                break;
+            }
+            uint32_t resolved = 0;
+            if (resolve_index(index, vertices.size(), resolved))
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "%s:%u: face index %ld out of range", path.c_str(), line_number, index);
+                return true;
+            }
+            // Skip the /texcoord/normal part of the corner
+            cursor = end;
+            while (*cursor != '\0' && *cursor != ' ' && *cursor != '\t')
+            {
+                cursor++;
+            }
+
+            if (corners == 0)
+            {
+                first = resolved;
+            }
+            else if (corners >= 2)
+            {
+                indices.push_back(first);
+                indices.push_back(previous);
+                indices.push_back(resolved);
+            }
+            previous = resolved;
+            corners++;
+        }
+        if (corners < 3)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "%s:%u: face needs three corners", path.c_str(), line_number);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool load_obj(const std::string& path, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    vertices.clear();
+    indices.clear();
+
+    try
+    {
+        MappedFile file(path);
+        const char* data = static_cast<const char*>(file.getData());
+        size_t size = file.getSize();
+
+        std::string line;
+        uint32_t line_number = 0;
+        size_t start = 0;
+        while (start < size)
+        {
+            size_t end = start;
+            while (end < size && data[end] != '\n')
+            {
+                end++;
+            }
+            line.assign(data + start, end - start);
+            line_number++;
+            if (parse_line(line.c_str(), line_number, vertices, indices, path))
+            {
+                return true;
+            }
+            start = end + 1;
+        }
+    }
+    catch(const std::runtime_error& e)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to read %s: %s", path.c_str(), e.what());
+        return true;
+    }
+
+    if (vertices.empty() || indices.empty())
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "%s has no triangles", path.c_str());
+        return true;
+    }
+    return false;
+}
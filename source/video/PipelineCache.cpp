@@ -0,0 +1,120 @@
+#include "video/PipelineCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+PipelineCache::PipelineCache(VulkanContext& ctx, const std::string& path) : m_ctx(ctx), m_path(path)
+{
+    std::vector<char> blob;
+    if (!m_path.empty())
+    {
+        std::ifstream file(m_path, std::ios::ate | std::ios::binary);
+        if (file.is_open())
+        {
+            blob.resize(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(blob.data(), static_cast<std::streamsize>(blob.size()));
+        }
+    }
+
+    if (!blob.empty() && !isCompatible(blob))
+    {
+        SDL_LogInfo(SDL_LOG_CATEGORY_VIDEO, "pipeline cache %s was built by another driver, ignoring it", m_path.c_str());
+        blob.clear();
+    }
+    m_loaded = !blob.empty();
+
+    VkPipelineCacheCreateInfo cache_info = {};
+    cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_info.initialDataSize = blob.size();
+    cache_info.pInitialData = blob.empty() ? nullptr : blob.data();
+
+    if (ctx.disp.createPipelineCache(&cache_info, nullptr, &m_cache) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create pipeline cache");
+        throw std::runtime_error("failed to create pipeline cache");
+    }
+}
+
+PipelineCache::~PipelineCache()
+{
+    m_ctx.disp.destroyPipelineCache(m_cache, nullptr);
+}
+
+// Drivers are allowed to reject foreign blobs themselves, but some crash or
+// silently return garbage, so check the header before handing it over
+bool PipelineCache::isCompatible(const std::vector<char>& blob)
+{
+    VkPipelineCacheHeaderVersionOne header = {};
+    if (blob.size() < sizeof(header))
+    {
+        return false;
+    }
+    memcpy(&header, blob.data(), sizeof(header));
+
+    const VkPhysicalDeviceProperties& properties = m_ctx.device.physical_device.properties;
+    return header.headerSize >= sizeof(header) &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID == properties.vendorID &&
+           header.deviceID == properties.deviceID &&
+           memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+VkPipelineCache PipelineCache::get()
+{
+    return m_cache;
+}
+
+bool PipelineCache::isLoaded()
+{
+    return m_loaded;
+}
+
+bool PipelineCache::save()
+{
+    if (m_path.empty())
+    {
+        return false;
+    }
+
+    size_t size = 0;
+    if (m_ctx.disp.getPipelineCacheData(m_cache, &size, nullptr) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to query pipeline cache size");
+        return true;
+    }
+    std::vector<char> blob(size);
+    if (m_ctx.disp.getPipelineCacheData(m_cache, &size, blob.data()) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to read pipeline cache");
+        return true;
+    }
+    blob.resize(size);
+
+    // Never leave a truncated cache behind if the process dies mid-write
+    std::string tmp_path = m_path + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to open %s", tmp_path.c_str());
+            return true;
+        }
+        file.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+        if (!file.good())
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to write %s", tmp_path.c_str());
+            return true;
+        }
+    }
+    if (std::rename(tmp_path.c_str(), m_path.c_str()) != 0)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to replace %s", m_path.c_str());
+        std::remove(tmp_path.c_str());
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,436 @@
+#include "video/PipelineManager.h"
+
+#include <functional>
+
+#include "core/JobSystem.h"
+#include "core/Trace.h"
+#include "video/ShaderLibrary.h"
+#include "video/Vertex.h"
+
+bool PipelineKey::operator==(const PipelineKey& other) const
+{
+    return vertex_shader == other.vertex_shader &&
+           fragment_shader == other.fragment_shader &&
+           vertex_layout == other.vertex_layout &&
+           topology == other.topology &&
+           polygon_mode == other.polygon_mode &&
+           cull_mode == other.cull_mode &&
+           front_face == other.front_face &&
+           blend_enable == other.blend_enable &&
+           render_pass == other.render_pass &&
+           color_format == other.color_format &&
+           subpass == other.subpass &&
+           layout == other.layout;
+}
+
+// FNV-1a over the fixed-function state, mixed with the shader name hashes
+size_t PipelineKeyHash::operator()(const PipelineKey& key) const
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](uint64_t value) {
+        for (int i = 0; i < 8; i++)
+        {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    };
+
+    mix(std::hash<std::string>()(key.vertex_shader));
+    mix(std::hash<std::string>()(key.fragment_shader));
+    mix(static_cast<uint64_t>(key.vertex_layout));
+    mix(static_cast<uint64_t>(key.topology));
+    mix(static_cast<uint64_t>(key.polygon_mode));
+    mix(static_cast<uint64_t>(key.cull_mode));
+    mix(static_cast<uint64_t>(key.front_face));
+    mix(static_cast<uint64_t>(key.blend_enable));
+    mix(reinterpret_cast<uint64_t>(key.render_pass));
+    mix(static_cast<uint64_t>(key.color_format));
+    mix(static_cast<uint64_t>(key.subpass));
+    mix(reinterpret_cast<uint64_t>(key.layout));
+    return static_cast<size_t>(hash);
+}
+
+// Appends the binding and attributes of one vertex type's format
+template<typename T>
+static void append_vertex_input(std::vector<VkVertexInputBindingDescription>& bindings, std::vector<VkVertexInputAttributeDescription>& attributes)
+{
+    bindings.push_back(T::getBindingDescription());
+    auto descriptions = T::getAttributeDescriptions();
+    attributes.insert(attributes.end(), descriptions.begin(), descriptions.end());
+}
+
+PipelineManager::PipelineManager(VulkanContext& ctx, VkPipelineCache cache, VkPipelineLayout layout, ShaderLibrary& shaders, JobSystem* jobs)
+    : m_ctx(ctx), m_cache(cache), m_layout(layout), m_shaders(shaders), m_jobs(jobs)
+{
+}
+
+PipelineManager::~PipelineManager()
+{
+    // Compiles in flight still write into the entries
+    waitIdle();
+    for (auto& entry : m_entries)
+    {
+        m_ctx.disp.destroyPipeline(entry.pipeline, nullptr);
+        m_ctx.disp.destroyPipeline(entry.replacement, nullptr);
+    }
+}
+
+PipelineHandle PipelineManager::request(const PipelineKey& key)
+{
+    PipelineHandle handle;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_handles.find(key);
+        if (it != m_handles.end())
+        {
+            return it->second;
+        }
+
+        handle = static_cast<PipelineHandle>(m_entries.size());
+        m_entries.emplace_back();
+        m_entries.back().key = key;
+        m_handles.emplace(key, handle);
+        m_pending++;
+    }
+
+    if (m_jobs != nullptr)
+    {
+        m_jobs->submit([this, handle]() { compile(handle); });
+    }
+    else
+    {
+        compile(handle);
+    }
+    return handle;
+}
+
+void PipelineManager::compile(PipelineHandle handle)
+{
+    Entry* entry;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        entry = &m_entries[handle];
+    }
+
+    // The key is never written after request(), no lock needed to read it
+    VkPipeline pipeline = createPipeline(entry->key);
+    entry->pipeline = pipeline;
+    entry->state.store(pipeline != VK_NULL_HANDLE ? Ready : Failed, std::memory_order_release);
+
+    // Notify under the lock so the manager cannot be destroyed in between
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending--;
+    m_compiled.notify_all();
+}
+
+VkPipeline PipelineManager::tryGet(PipelineHandle handle, PipelineHandle fallback)
+{
+    for (PipelineHandle candidate : { handle, fallback })
+    {
+        if (candidate == INVALID_PIPELINE)
+        {
+            continue;
+        }
+
+        Entry* entry;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (candidate >= m_entries.size())
+            {
+                continue;
+            }
+            entry = &m_entries[candidate];
+        }
+        if (entry->state.load(std::memory_order_acquire) == Ready)
+        {
+            return entry->pipeline;
+        }
+    }
+    return VK_NULL_HANDLE;
+}
+
+bool PipelineManager::isReady(PipelineHandle handle)
+{
+    return tryGet(handle) != VK_NULL_HANDLE;
+}
+
+bool PipelineManager::hasFailed(PipelineHandle handle)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return handle < m_entries.size() && m_entries[handle].state.load(std::memory_order_acquire) == Failed;
+}
+
+VkPipeline PipelineManager::wait(PipelineHandle handle)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (handle >= m_entries.size())
+    {
+        return VK_NULL_HANDLE;
+    }
+    Entry& entry = m_entries[handle];
+    m_compiled.wait(lock, [&entry]() { return entry.state.load(std::memory_order_acquire) != Pending; });
+    return entry.pipeline;
+}
+
+void PipelineManager::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_compiled.wait(lock, [this]() { return m_pending == 0; });
+}
+
+VkPipeline PipelineManager::get(const PipelineKey& key)
+{
+    return wait(request(key));
+}
+
+size_t PipelineManager::getPipelineCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+void PipelineManager::rebuild(const std::string& shader_name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (PipelineHandle handle = 0; handle < m_entries.size(); handle++)
+    {
+        Entry& entry = m_entries[handle];
+        if (entry.key.vertex_shader != shader_name && entry.key.fragment_shader != shader_name)
+        {
+            continue;
+        }
+        if (entry.state.load(std::memory_order_acquire) == Pending)
+        {
+            // The first compile may already have read the old module
+            entry.rebuild_again = true;
+            continue;
+        }
+        if (entry.rebuilding)
+        {
+            entry.rebuild_again = true;
+            continue;
+        }
+        queueRebuild(handle);
+    }
+}
+
+void PipelineManager::queueRebuild(PipelineHandle handle)
+{
+    m_entries[handle].rebuilding = true;
+    m_entries[handle].rebuild_again = false;
+    m_pending++;
+    m_rebuilding++;
+
+    if (m_jobs != nullptr)
+    {
+        m_jobs->submit([this, handle]() { compileReplacement(handle); });
+    }
+    else
+    {
+        // Runs inline with m_mutex held, so compile without taking it again
+        m_entries[handle].replacement = createPipeline(m_entries[handle].key);
+        m_entries[handle].rebuilt.store(true, std::memory_order_release);
+        m_pending--;
+    }
+}
+
+void PipelineManager::compileReplacement(PipelineHandle handle)
+{
+    Entry* entry;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        entry = &m_entries[handle];
+    }
+
+    entry->replacement = createPipeline(entry->key);
+    entry->rebuilt.store(true, std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending--;
+    m_compiled.notify_all();
+}
+
+void PipelineManager::applyRebuilds(std::vector<VkPipeline>& retired)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (PipelineHandle handle = 0; handle < m_entries.size(); handle++)
+    {
+        Entry& entry = m_entries[handle];
+        // A shader changed during the first compile
+        if (entry.rebuild_again && !entry.rebuilding && entry.state.load(std::memory_order_acquire) != Pending)
+        {
+            queueRebuild(handle);
+        }
+    }
+    if (m_rebuilding == 0)
+    {
+        return;
+    }
+
+    for (PipelineHandle handle = 0; handle < m_entries.size(); handle++)
+    {
+        Entry& entry = m_entries[handle];
+        if (!entry.rebuilding || !entry.rebuilt.load(std::memory_order_acquire))
+        {
+            continue;
+        }
+        entry.rebuilding = false;
+        entry.rebuilt.store(false, std::memory_order_relaxed);
+        m_rebuilding--;
+
+        if (entry.replacement == VK_NULL_HANDLE)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to rebuild pipeline for %s / %s, keeping the old one",
+                         entry.key.vertex_shader.c_str(), entry.key.fragment_shader.c_str());
+        }
+        else
+        {
+            if (entry.pipeline != VK_NULL_HANDLE)
+            {
+                retired.push_back(entry.pipeline);
+            }
+            entry.pipeline = entry.replacement;
+            entry.state.store(Ready, std::memory_order_release);
+        }
+        entry.replacement = VK_NULL_HANDLE;
+
+        if (entry.rebuild_again)
+        {
+            queueRebuild(handle);
+        }
+    }
+}
+
+VkPipeline PipelineManager::createPipeline(const PipelineKey& key)
+{
+    TRACE_ZONE("compile pipeline");
+    // Modules are owned by the library and shared with other pipelines
+    VkShaderModule vert_module = m_shaders.getModule(key.vertex_shader);
+    VkShaderModule frag_module = m_shaders.getModule(key.fragment_shader);
+    if (vert_module == VK_NULL_HANDLE || frag_module == VK_NULL_HANDLE)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create shader module");
+        return VK_NULL_HANDLE;
+    }
+
+    VkPipelineShaderStageCreateInfo vert_stage_info = {};
+    vert_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vert_stage_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vert_stage_info.module = vert_module;
+    vert_stage_info.pName = "main";
+
+    VkPipelineShaderStageCreateInfo frag_stage_info = {};
+    frag_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    frag_stage_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    frag_stage_info.module = frag_module;
+    frag_stage_info.pName = "main";
+
+    VkPipelineShaderStageCreateInfo shader_stages[] = { vert_stage_info, frag_stage_info };
+
+    std::vector<VkVertexInputBindingDescription> bindings;
+    std::vector<VkVertexInputAttributeDescription> attributes;
+    switch (key.vertex_layout)
+    {
+        case VertexLayout::PositionColor:
+            append_vertex_input<Vertex>(bindings, attributes);
+            break;
+        case VertexLayout::PositionColorInstanced:
+            append_vertex_input<Vertex>(bindings, attributes);
+            append_vertex_input<Instance>(bindings, attributes);
+            break;
+        case VertexLayout::Compact:
+            append_vertex_input<CompactVertex>(bindings, attributes);
+            break;
+        case VertexLayout::CompactInstanced:
+            append_vertex_input<CompactVertex>(bindings, attributes);
+            append_vertex_input<Instance>(bindings, attributes);
+            break;
+    }
+
+    VkPipelineVertexInputStateCreateInfo vertex_input_info = {};
+    vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertex_input_info.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
+    vertex_input_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+    vertex_input_info.pVertexBindingDescriptions = bindings.data();
+    vertex_input_info.pVertexAttributeDescriptions = attributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly = {};
+    input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    input_assembly.topology = key.topology;
+    input_assembly.primitiveRestartEnable = VK_FALSE;
+
+    // Viewport and scissor are dynamic, only their count is baked in
+    VkPipelineViewportStateCreateInfo viewport_state = {};
+    viewport_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewport_state.viewportCount = 1;
+    viewport_state.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer = {};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = key.polygon_mode;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = key.cull_mode;
+    rasterizer.frontFace = key.front_face;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+    colorBlendAttachment.colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = key.blend_enable ? VK_TRUE : VK_FALSE;
+    // Straight alpha blending
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo color_blending = {};
+    color_blending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    color_blending.logicOpEnable = VK_FALSE;
+    color_blending.logicOp = VK_LOGIC_OP_COPY;
+    color_blending.attachmentCount = 1;
+    color_blending.pAttachments = &colorBlendAttachment;
+    color_blending.blendConstants[0] = 0.0f;
+    color_blending.blendConstants[1] = 0.0f;
+    color_blending.blendConstants[2] = 0.0f;
+    color_blending.blendConstants[3] = 0.0f;
+
+    std::vector<VkDynamicState> dynamic_states = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+    VkPipelineDynamicStateCreateInfo dynamic_info = {};
+    dynamic_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamic_info.dynamicStateCount = static_cast<uint32_t>(dynamic_states.size());
+    dynamic_info.pDynamicStates = dynamic_states.data();
+
+    VkGraphicsPipelineCreateInfo pipeline_info = {};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipeline_info.stageCount = 2;
+    pipeline_info.pStages = shader_stages;
+    pipeline_info.pVertexInputState = &vertex_input_info;
+    pipeline_info.pInputAssemblyState = &input_assembly;
+    pipeline_info.pViewportState = &viewport_state;
+    pipeline_info.pRasterizationState = &rasterizer;
+    pipeline_info.pMultisampleState = &multisampling;
+    pipeline_info.pColorBlendState = &color_blending;
+    pipeline_info.pDynamicState = &dynamic_info;
+    pipeline_info.layout = key.layout != VK_NULL_HANDLE ? key.layout : m_layout;
+    pipeline_info.renderPass = key.render_pass;
+    pipeline_info.subpass = key.subpass;
+    pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (m_ctx.disp.createGraphicsPipelines(m_cache, 1, &pipeline_info, nullptr, &pipeline) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create pipline");
+        pipeline = VK_NULL_HANDLE;
+    }
+    return pipeline;
+}
@@ -1,37 +1,48 @@
 #include "video/Renderer.h"
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 
+#include "core/JobSystem.h"
+#include "core/MappedFile.h"
+#include "core/Trace.h"
+#include "video/AssetStreamer.h"
+#include "video/BindlessTable.h"
 #include "video/Renderer.h"
 #include "video/Buffer.h"
+#include "video/GpuProfiler.h"
+#include "video/Indices.h"
+#include "video/MeshFile.h"
+#include "video/MeshOptimizer.h"
+#include "video/PipelineCache.h"
+#include "video/PipelineManager.h"
+#include "video/ShaderLibrary.h"
+#include "video/ShaderWatcher.h"
+#include "video/UploadManager.h"
 #include "video/Vertex.h"
+#include "video/VertexQuantize.h"
 #include "video/VmaUsage.h"
 
 
-const int MAX_FRAMES_IN_FLIGHT = 4;
+const uint32_t OFFSCREEN_IMAGE_COUNT = 3;
+const VkFormat OFFSCREEN_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+const VkDeviceSize STAGING_RING_SIZE = 16 * 1024 * 1024;
+// Fraction of a heap's budget past which a warning is logged
+const double MEMORY_BUDGET_WARNING = 0.9;
+// Compiled SPIR-V, in the build tree
+#ifdef RENDERER_SHADER_DIR
+#define SHADER_FOLDER RENDERER_SHADER_DIR
+#else
 #define SHADER_FOLDER "../shaders/"
+#endif
 
 // Util function
 
-std::vector<char> readFile(const std::string& filename)
+double elapsed_ms(std::chrono::steady_clock::time_point start)
 {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-    if (!file.is_open())
-    {
-        throw std::runtime_error("failed to open file!");
-    }
-
-    size_t file_size = (size_t)file.tellg();
-    std::vector<char> buffer(file_size);
-
-    file.seekg(0);
-    file.read(buffer.data(), static_cast<std::streamsize>(file_size));
-
-    file.close();
-
-    return buffer;
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
 // SDL functions
@@ -72,10 +83,16 @@ void destroy_window(SDL_Window* window)
 
 bool device_initialization(VulkanContext& ctx, uint32_t width, uint32_t height)
 {
-    ctx.window = create_window("Vulkan Triangle", width, height, true);
+    if (!ctx.headless)
+    {
+        ctx.window = create_window("Vulkan Triangle", width, height, true);
+    }
 
     vkb::InstanceBuilder instance_builder;
-    auto instance_ret = instance_builder.require_api_version(1,3,0).request_validation_layers().build();
+    auto instance_ret = instance_builder.require_api_version(1,3,0)
+                                        .request_validation_layers()
+                                        .set_headless(ctx.headless)
+                                        .build();
     if (!instance_ret)
     {
         SDL_LogError(SDL_LOG_CATEGORY_VIDEO, instance_ret.error().message().c_str());
@@ -85,21 +102,54 @@ bool device_initialization(VulkanContext& ctx, uint32_t width, uint32_t height)
     ctx.instance = instance_ret.value();
     ctx.inst_disp = ctx.instance.make_table();
 
-    ctx.surface = create_surface(ctx.instance, ctx.window);
-    if (ctx.surface == VK_NULL_HANDLE)
+    // Timeline semaphores track asynchronous uploads
+    VkPhysicalDeviceVulkan12Features features_12 = {};
+    features_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features_12.timelineSemaphore = VK_TRUE;
+    if (ctx.bindless)
     {
-        return true;
+        features_12.runtimeDescriptorArray = VK_TRUE;
+        features_12.descriptorBindingPartiallyBound = VK_TRUE;
+        features_12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        features_12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    }
+
+    // Culled draws are one indirect count draw, firstInstance selects the object
+    VkPhysicalDeviceFeatures features = {};
+    if (ctx.gpu_culling)
+    {
+        features_12.drawIndirectCount = VK_TRUE;
+        features.drawIndirectFirstInstance = VK_TRUE;
     }
-    
 
     vkb::PhysicalDeviceSelector phys_device_selector(ctx.instance);
-    auto phys_device_ret = phys_device_selector.set_surface(ctx.surface).select();
+    phys_device_selector.set_required_features_12(features_12);
+    phys_device_selector.set_required_features(features);
+    // Driver reported heap budgets, VMA estimates them without it
+    phys_device_selector.add_desired_extension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (ctx.headless)
+    {
+        // No surface: accept any device type so CPU implementations (lavapipe) qualify
+        phys_device_selector.require_present(false).allow_any_gpu_device_type(true);
+    }
+    else
+    {
+        ctx.surface = create_surface(ctx.instance, ctx.window);
+        if (ctx.surface == VK_NULL_HANDLE)
+        {
+            return true;
+        }
+        phys_device_selector.set_surface(ctx.surface);
+    }
+
+    auto phys_device_ret = phys_device_selector.select();
     if (!phys_device_ret)
     {
         SDL_LogError(SDL_LOG_CATEGORY_VIDEO, phys_device_ret.error().message().c_str());
         return true;
     }
     vkb::PhysicalDevice physical_device = phys_device_ret.value();
+    ctx.memory_budget = physical_device.is_extension_present(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
 
     vkb::DeviceBuilder device_builder{ physical_device };
     auto device_ret = device_builder.build();
@@ -125,14 +175,112 @@ bool create_swapchain(VulkanContext& ctx, uint32_t width, uint32_t height)
     }
     vkb::destroy_swapchain(ctx.swapchain);
     ctx.swapchain = swap_ret.value();
+    ctx.extent = ctx.swapchain.extent;
+    ctx.color_format = ctx.swapchain.image_format;
+    return false;
+}
+
+bool create_offscreen_images(VulkanContext& ctx, RenderData& data, uint32_t width, uint32_t height)
+{
+    VmaAllocator& allocator = getAllocator();
+    ctx.extent = { width, height };
+    ctx.color_format = OFFSCREEN_FORMAT;
+
+    VkImageCreateInfo image_info = {};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = ctx.color_format;
+    image_info.extent = { width, height, 1 };
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VmaAllocationCreateInfo allocation_info = {};
+    allocation_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+    data.swapchain_images.resize(OFFSCREEN_IMAGE_COUNT);
+    data.swapchain_image_views.resize(OFFSCREEN_IMAGE_COUNT);
+    data.offscreen_allocations.resize(OFFSCREEN_IMAGE_COUNT);
+    for (uint32_t i = 0; i < OFFSCREEN_IMAGE_COUNT; i++)
+    {
+        if (vmaCreateImage(allocator, &image_info, &allocation_info, &data.swapchain_images[i], &data.offscreen_allocations[i], nullptr) != VK_SUCCESS)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create offscreen image");
+            return true;
+        }
+
+        VkImageViewCreateInfo view_info = {};
+        view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.image = data.swapchain_images[i];
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = ctx.color_format;
+        view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.layerCount = 1;
+
+        if (ctx.disp.createImageView(&view_info, nullptr, &data.swapchain_image_views[i]) != VK_SUCCESS)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create offscreen image view");
+            return true;
+        }
+    }
+
+    try
+    {
+        data.readback_buffer = new Buffer(BufferType::ReadbackBuffer, width * height, 4);
+    }
+    catch(const std::runtime_error& e)
+    {
+        return true;
+    }
     return false;
 }
 
+void destroy_render_targets(VulkanContext& ctx, RenderData& data)
+{
+    if (!ctx.headless)
+    {
+        ctx.swapchain.destroy_image_views(data.swapchain_image_views);
+        return;
+    }
+
+    VmaAllocator& allocator = getAllocator();
+    for (size_t i = 0; i < data.swapchain_images.size(); i++)
+    {
+        ctx.disp.destroyImageView(data.swapchain_image_views[i], nullptr);
+        vmaDestroyImage(allocator, data.swapchain_images[i], data.offscreen_allocations[i]);
+    }
+    data.swapchain_images.clear();
+    data.swapchain_image_views.clear();
+    data.offscreen_allocations.clear();
+
+    delete data.readback_buffer;
+    data.readback_buffer = nullptr;
+}
+
 bool create_descriptor_set_layout(VulkanContext& ctx, RenderData& data)
 {
+    if (ctx.bindless)
+    {
+        try
+        {
+            data.bindless = new BindlessTable(ctx);
+        }
+        catch(const std::runtime_error& e)
+        {
+            return true;
+        }
+        data.descriptor_set_layout = data.bindless->getLayout();
+        return false;
+    }
+
     VkDescriptorSetLayoutBinding uboLayoutBinding{};
     uboLayoutBinding.binding = 0;
-    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     uboLayoutBinding.descriptorCount = 1;
     uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
     uboLayoutBinding.pImmutableSamplers = nullptr; // Optional
@@ -152,16 +300,22 @@ bool create_descriptor_set_layout(VulkanContext& ctx, RenderData& data)
 
 bool create_descriptor_pool(VulkanContext& ctx, RenderData& data)
 {
-    std::cout << "MAX_FRAMES_IN_FLIGHT: " << MAX_FRAMES_IN_FLIGHT << std::endl;
+    if (ctx.bindless)
+    {
+        // The table owns its pool
+        return false;
+    }
+
+    // A single set addresses every frame's uniforms through dynamic offsets
     VkDescriptorPoolSize poolSize{};
-    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSize.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSize.descriptorCount = 1;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = 1;
     poolInfo.pPoolSizes = &poolSize;
-    poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    poolInfo.maxSets = 1;
     poolInfo.flags = 0;
 
     if (ctx.disp.createDescriptorPool(&poolInfo, nullptr, &data.descriptor_pool) != VK_SUCCESS)
@@ -169,45 +323,46 @@ bool create_descriptor_pool(VulkanContext& ctx, RenderData& data)
         throw std::runtime_error("failed to create descriptor pool!");
     }
 
-    std::cout << "END MAX_FRAMES_IN_FLIGHT: " << MAX_FRAMES_IN_FLIGHT << std::endl;
-
     return false;
 }
 
 bool create_descriptor_sets(VulkanContext& ctx, RenderData& data)
 {
-    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, data.descriptor_set_layout);
+    if (ctx.bindless)
+    {
+        data.descriptor_set = data.bindless->getSet();
+        data.uniform_buffer_index = data.bindless->addStorageBuffer(data.uniform_buffer->getBuffer());
+        return data.uniform_buffer_index == UINT32_MAX;
+    }
+
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = data.descriptor_pool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-    allocInfo.pSetLayouts = layouts.data();
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &data.descriptor_set_layout;
 
-    data.descriptor_sets.resize(MAX_FRAMES_IN_FLIGHT);
-    if (ctx.disp.allocateDescriptorSets(&allocInfo, data.descriptor_sets.data()) != VK_SUCCESS) {
+    if (ctx.disp.allocateDescriptorSets(&allocInfo, &data.descriptor_set) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate descriptor sets!");
     }
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-    {
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = data.uniformBuffers[i]->getBuffer();
-        bufferInfo.offset = 0;
-        bufferInfo.range = sizeof(UniformBufferObject);
-
-        VkWriteDescriptorSet descriptorWrite{};
-        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrite.dstSet = data.descriptor_sets[i];
-        descriptorWrite.dstBinding = 0;
-        descriptorWrite.dstArrayElement = 0;
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrite.descriptorCount = 1;
-        descriptorWrite.pBufferInfo = &bufferInfo;
-        descriptorWrite.pImageInfo = nullptr; // Optional
-        descriptorWrite.pTexelBufferView = nullptr; // Optional
-
-        ctx.disp.updateDescriptorSets(1, &descriptorWrite, 0, nullptr);
-    }
+    // The window covers one uniform, draws move it with their dynamic offset
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = data.uniform_buffer->getBuffer();
+    bufferInfo.offset = 0;
+    bufferInfo.range = sizeof(UniformBufferObject);
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = data.descriptor_set;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+    descriptorWrite.pImageInfo = nullptr; // Optional
+    descriptorWrite.pTexelBufferView = nullptr; // Optional
+
+    ctx.disp.updateDescriptorSets(1, &descriptorWrite, 0, nullptr);
     return false;
 }
 
@@ -221,6 +376,12 @@ bool get_queues(VulkanContext& ctx, RenderData& data)
     }
     ctx.graphics_queue = gq.value();
 
+    if (ctx.headless)
+    {
+        ctx.present_queue = VK_NULL_HANDLE;
+        return false;
+    }
+
     auto pq = ctx.device.get_queue(vkb::QueueType::present);
     if (!pq.has_value())
     {
@@ -234,14 +395,14 @@ bool get_queues(VulkanContext& ctx, RenderData& data)
 bool create_render_pass(VulkanContext& ctx, RenderData& data)
 {
     VkAttachmentDescription color_attachment = {};
-    color_attachment.format = ctx.swapchain.image_format;
+    color_attachment.format = ctx.color_format;
     color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
     color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    color_attachment.finalLayout = ctx.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentReference color_attachment_ref = {};
     color_attachment_ref.attachment = 0;
@@ -252,13 +413,21 @@ bool create_render_pass(VulkanContext& ctx, RenderData& data)
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &color_attachment_ref;
 
-    VkSubpassDependency dependency = {};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    VkSubpassDependency dependencies[2] = {};
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    // Offscreen images are read back with a transfer once the pass is done
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
     VkRenderPassCreateInfo render_pass_info = {};
     render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -266,8 +435,8 @@ bool create_render_pass(VulkanContext& ctx, RenderData& data)
     render_pass_info.pAttachments = &color_attachment;
     render_pass_info.subpassCount = 1;
     render_pass_info.pSubpasses = &subpass;
-    render_pass_info.dependencyCount = 1;
-    render_pass_info.pDependencies = &dependency;
+    render_pass_info.dependencyCount = ctx.headless ? 2 : 1;
+    render_pass_info.pDependencies = dependencies;
 
     if (ctx.disp.createRenderPass(&render_pass_info, nullptr, &data.render_pass) != VK_SUCCESS) {
         SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create render pass\n");
@@ -277,176 +446,142 @@ bool create_render_pass(VulkanContext& ctx, RenderData& data)
     return false;
 }
 
-VkShaderModule createShaderModule(VulkanContext& ctx, const std::vector<char>& code)
-{
-    VkShaderModuleCreateInfo create_info = {};
-    create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    create_info.codeSize = code.size();
-    create_info.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-    VkShaderModule shaderModule;
-    if (ctx.disp.createShaderModule(&create_info, nullptr, &shaderModule) != VK_SUCCESS)
-    {
-        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Failed to create shader module");
-        return VK_NULL_HANDLE; // failed to create shader module
-    }
-
-    return shaderModule;
-}
-
-bool create_graphics_pipeline(VulkanContext& ctx, RenderData& data)
+bool create_pipeline_cache(VulkanContext& ctx, RenderData& data, const std::string& path)
 {
-    std::vector<char> vert_code;
-    std::vector<char> frag_code;
     try
     {
-        vert_code = readFile(std::string(SHADER_FOLDER) + "/triangle.vert.spv");
-        frag_code = readFile(std::string(SHADER_FOLDER) + "/triangle.frag.spv");
+        data.pipeline_cache = new PipelineCache(ctx, path);
     }
-    catch(const std::exception& e)
+    catch(const std::runtime_error& e)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Failed to read shader files");
         return true;
     }
+    data.init_timings.warm_pipeline_cache = data.pipeline_cache->isLoaded();
+    return false;
+}
 
-    VkShaderModule vert_module = createShaderModule(ctx, vert_code);
-    VkShaderModule frag_module = createShaderModule(ctx, frag_code);
-    if (vert_module == VK_NULL_HANDLE || frag_module == VK_NULL_HANDLE)
+// The mesh pipeline drawn by default, targeting the main render pass
+PipelineKey default_pipeline_key(VulkanContext& ctx, RenderData& data)
+{
+    PipelineKey key;
+    if (ctx.bindless)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create shader module");
-        return true;
+        key.vertex_shader = "triangle_bindless.vert.spv";
     }
+    if (ctx.compact_vertices)
+    {
+        key.vertex_layout = VertexLayout::Compact;
+    }
+    key.render_pass = data.render_pass;
+    key.color_format = ctx.color_format;
+    return key;
+}
 
-    VkPipelineShaderStageCreateInfo vert_stage_info = {};
-    vert_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vert_stage_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vert_stage_info.module = vert_module;
-    vert_stage_info.pName = "main";
-
-    VkPipelineShaderStageCreateInfo frag_stage_info = {};
-    frag_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    frag_stage_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    frag_stage_info.module = frag_module;
-    frag_stage_info.pName = "main";
-
-    VkPipelineShaderStageCreateInfo shader_stages[] = { vert_stage_info, frag_stage_info };
-
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
-
-    VkPipelineVertexInputStateCreateInfo vertex_input_info = {};
-    vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertex_input_info.vertexBindingDescriptionCount = 1;
-    vertex_input_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertex_input_info.pVertexBindingDescriptions = &bindingDescription;
-    vertex_input_info.pVertexAttributeDescriptions = attributeDescriptions.data();
-
-    VkPipelineInputAssemblyStateCreateInfo input_assembly = {};
-    input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    input_assembly.primitiveRestartEnable = VK_FALSE;
-
-    VkViewport viewport = {};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float)ctx.swapchain.extent.width;
-    viewport.height = (float)ctx.swapchain.extent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor = {};
-    scissor.offset = { 0, 0 };
-    scissor.extent = ctx.swapchain.extent;
-
-    VkPipelineViewportStateCreateInfo viewport_state = {};
-    viewport_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewport_state.viewportCount = 1;
-    viewport_state.pViewports = &viewport;
-    viewport_state.scissorCount = 1;
-    viewport_state.pScissors = &scissor;
-
-    VkPipelineRasterizationStateCreateInfo rasterizer = {};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-    rasterizer.depthBiasEnable = VK_FALSE;
-
-    VkPipelineMultisampleStateCreateInfo multisampling = {};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-    colorBlendAttachment.colorWriteMask =
-        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-
-    VkPipelineColorBlendStateCreateInfo color_blending = {};
-    color_blending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    color_blending.logicOpEnable = VK_FALSE;
-    color_blending.logicOp = VK_LOGIC_OP_COPY;
-    color_blending.attachmentCount = 1;
-    color_blending.pAttachments = &colorBlendAttachment;
-    color_blending.blendConstants[0] = 0.0f;
-    color_blending.blendConstants[1] = 0.0f;
-    color_blending.blendConstants[2] = 0.0f;
-    color_blending.blendConstants[3] = 0.0f;
-
+bool create_graphics_pipeline(VulkanContext& ctx, RenderData& data, uint32_t compile_threads)
+{
     VkPipelineLayoutCreateInfo pipeline_layout_info = {};
     pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipeline_layout_info.setLayoutCount = 1;
     pipeline_layout_info.pSetLayouts = &data.descriptor_set_layout;
     pipeline_layout_info.pushConstantRangeCount = 0;
 
+    VkPushConstantRange push_constant_range = {};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(BindlessDrawConstants);
+    if (ctx.bindless)
+    {
+        pipeline_layout_info.pushConstantRangeCount = 1;
+        pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+    }
+
     if (ctx.disp.createPipelineLayout(&pipeline_layout_info, nullptr, &data.pipeline_layout) != VK_SUCCESS)
     {
         SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create pipeline layout");
         return true;
     }
 
-    std::vector<VkDynamicState> dynamic_states = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    if (compile_threads > 0)
+    {
+        data.compile_jobs = new JobSystem(compile_threads);
+    }
+    data.shader_library = new ShaderLibrary(ctx, SHADER_FOLDER);
+    data.pipeline_manager = new PipelineManager(ctx, data.pipeline_cache->get(), data.pipeline_layout, *data.shader_library, data.compile_jobs);
 
-    VkPipelineDynamicStateCreateInfo dynamic_info = {};
-    dynamic_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamic_info.dynamicStateCount = static_cast<uint32_t>(dynamic_states.size());
-    dynamic_info.pDynamicStates = dynamic_states.data();
+    // Only fails here when compiling synchronously, otherwise the draws are
+    // skipped until the pipeline is ready
+    data.mesh_pipeline = data.pipeline_manager->request(default_pipeline_key(ctx, data));
+    if (data.pipeline_manager->hasFailed(data.mesh_pipeline))
+    {
+        return true;
+    }
+    return 0;
+}
 
-    VkGraphicsPipelineCreateInfo pipeline_info = {};
-    pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipeline_info.stageCount = 2;
-    pipeline_info.pStages = shader_stages;
-    pipeline_info.pVertexInputState = &vertex_input_info;
-    pipeline_info.pInputAssemblyState = &input_assembly;
-    pipeline_info.pViewportState = &viewport_state;
-    pipeline_info.pRasterizationState = &rasterizer;
-    pipeline_info.pMultisampleState = &multisampling;
-    pipeline_info.pColorBlendState = &color_blending;
-    pipeline_info.pDynamicState = &dynamic_info;
-    pipeline_info.layout = data.pipeline_layout;
-    pipeline_info.renderPass = data.render_pass;
-    pipeline_info.subpass = 0;
-    pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+bool create_instancing(VulkanContext& ctx, RenderData& data)
+{
+    // Bindless shaders read their uniforms by index, there is no instanced variant
+    if (data.instances_per_frame == 0 || ctx.bindless)
+    {
+        return false;
+    }
 
-    if (ctx.disp.createGraphicsPipelines(VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &data.graphics_pipeline) != VK_SUCCESS)
+    try
+    {
+        data.instance_buffer = new Buffer(BufferType::InstanceBuffer, data.frames_in_flight * data.instances_per_frame, sizeof(Instance));
+    }
+    catch(const std::runtime_error& e)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create pipline");
         return true;
     }
 
-    ctx.disp.destroyShaderModule(frag_module, nullptr);
-    ctx.disp.destroyShaderModule(vert_module, nullptr);
-    return 0;
+    PipelineKey key = default_pipeline_key(ctx, data);
+    key.vertex_shader = "triangle_instanced.vert.spv";
+    key.vertex_layout = ctx.compact_vertices ? VertexLayout::CompactInstanced : VertexLayout::PositionColorInstanced;
+    data.instanced_pipeline = data.pipeline_manager->request(key);
+    if (data.pipeline_manager->hasFailed(data.instanced_pipeline))
+    {
+        return true;
+    }
+    return false;
+}
+
+bool create_gpu_culling(VulkanContext& ctx, RenderData& data, uint32_t max_objects)
+{
+    if (ctx.bindless)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "gpu culling is not supported with bindless descriptors");
+        return true;
+    }
+
+    try
+    {
+        data.culling = new GpuCulling(ctx, *data.shader_library, data.pipeline_cache->get(), data.descriptor_set_layout, max_objects, data.frames_in_flight);
+    }
+    catch(const std::runtime_error& e)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create gpu culling: %s", e.what());
+        return true;
+    }
+
+    PipelineKey key = default_pipeline_key(ctx, data);
+    key.vertex_shader = "triangle_indirect.vert.spv";
+    key.layout = data.culling->getDrawLayout();
+    data.indirect_pipeline = data.pipeline_manager->request(key);
+    if (data.pipeline_manager->hasFailed(data.indirect_pipeline))
+    {
+        return true;
+    }
+    return false;
 }
 
 bool create_framebuffers(VulkanContext& ctx, RenderData& data)
 {
-    data.swapchain_images = ctx.swapchain.get_images().value();
-    data.swapchain_image_views = ctx.swapchain.get_image_views().value();
-    SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Number of FRAME Buffer %d", data.swapchain_image_views.size());
+    if (!ctx.headless)
+    {
+        data.swapchain_images = ctx.swapchain.get_images().value();
+        data.swapchain_image_views = ctx.swapchain.get_image_views().value();
+    }
     data.framebuffers.resize(data.swapchain_image_views.size());
 
     for (size_t i = 0; i < data.swapchain_image_views.size(); i++)
@@ -458,8 +593,8 @@ bool create_framebuffers(VulkanContext& ctx, RenderData& data)
         framebuffer_info.renderPass = data.render_pass;
         framebuffer_info.attachmentCount = 1;
         framebuffer_info.pAttachments = attachments;
-        framebuffer_info.width = ctx.swapchain.extent.width;
-        framebuffer_info.height = ctx.swapchain.extent.height;
+        framebuffer_info.width = ctx.extent.width;
+        framebuffer_info.height = ctx.extent.height;
         framebuffer_info.layers = 1;
 
         if (ctx.disp.createFramebuffer(&framebuffer_info, nullptr, &data.framebuffers[i]) != VK_SUCCESS)
@@ -485,218 +620,862 @@ bool create_command_pool(VulkanContext& ctx, RenderData& data)
     return false;
 }
 
-bool record_command_buffers(VulkanContext& ctx, RenderData& data)
+bool create_frame_contexts(VulkanContext& ctx, RenderData& data)
 {
-    data.command_buffers.resize(data.framebuffers.size());
+    data.frames.resize(data.frames_in_flight);
 
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = ctx.command_pool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = (uint32_t)data.command_buffers.size();
+    VkCommandPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    pool_info.queueFamilyIndex = ctx.device.get_queue_index(vkb::QueueType::graphics).value();
 
-    if (ctx.disp.allocateCommandBuffers(&allocInfo, data.command_buffers.data()) != VK_SUCCESS)
-    {
-        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to allocate command buffers");
-        return true;
-    }
-    SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Number of Command Buffer %d", data.command_buffers.size());
+    VkSemaphoreCreateInfo semaphore_info = {};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    VkFenceCreateInfo fence_info = {};
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    for (size_t i = 0; i < data.command_buffers.size(); i++)
+    for (size_t i = 0; i < data.frames_in_flight; i++)
     {
-        VkCommandBufferBeginInfo begin_info = {};
-        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        FrameContext& frame = data.frames[i];
 
-        if (ctx.disp.beginCommandBuffer(data.command_buffers[i], &begin_info) != VK_SUCCESS)
+        if (ctx.disp.createSemaphore(&semaphore_info, nullptr, &frame.available_semaphore) != VK_SUCCESS ||
+            ctx.disp.createSemaphore(&semaphore_info, nullptr, &frame.finished_semaphore) != VK_SUCCESS ||
+            ctx.disp.createFence(&fence_info, nullptr, &frame.in_flight_fence) != VK_SUCCESS)
         {
-            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to begin recording command buffer");
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create sync objects");
             return true;
         }
 
-        VkRenderPassBeginInfo render_pass_info = {};
-        render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        render_pass_info.renderPass = data.render_pass;
-        render_pass_info.framebuffer = data.framebuffers[i];
-        render_pass_info.renderArea.offset = { 0, 0 };
-        render_pass_info.renderArea.extent = ctx.swapchain.extent;
-        VkClearValue clearColor{ { { 0.0f, 0.0f, 0.0f, 1.0f } } };
-        render_pass_info.clearValueCount = 1;
-        render_pass_info.pClearValues = &clearColor;
-
-        VkViewport viewport = {};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = (float)ctx.swapchain.extent.width;
-        viewport.height = (float)ctx.swapchain.extent.height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-
-        VkRect2D scissor = {};
-        scissor.offset = { 0, 0 };
-        scissor.extent = ctx.swapchain.extent;
-
-        ctx.disp.cmdSetViewport(data.command_buffers[i], 0, 1, &viewport);
-        ctx.disp.cmdSetScissor(data.command_buffers[i], 0, 1, &scissor);
-
-        VkDeviceSize offset = 0;
-        ctx.disp.cmdBeginRenderPass(data.command_buffers[i], &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+        if (ctx.disp.createCommandPool(&pool_info, nullptr, &frame.command_pool) != VK_SUCCESS)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create frame command pool");
+            return true;
+        }
 
-        ctx.disp.cmdBindPipeline(data.command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, data.graphics_pipeline);
-        ctx.disp.cmdBindVertexBuffers(data.command_buffers[i], 0, 1, &data.vertex_buffer->getBuffer(), &offset);
-        ctx.disp.cmdBindIndexBuffer(data.command_buffers[i], data.index_buffer->getBuffer(), 0, VK_INDEX_TYPE_UINT16);
-        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "BEFORE BIND %d", i);
-        ctx.disp.cmdBindDescriptorSets(data.command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, data.pipeline_layout, 0, 1, &data.descriptor_sets[i], 0, nullptr);
-        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "AFTER BIND %d", i);
-        ctx.disp.cmdDrawIndexed(data.command_buffers[i], data.index_buffer->getNumberOfElements(), 1, 0, 0, 0);
-        
-        ctx.disp.cmdEndRenderPass(data.command_buffers[i]);
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = frame.command_pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
 
-        if (ctx.disp.endCommandBuffer(data.command_buffers[i]) != VK_SUCCESS)
+        if (ctx.disp.allocateCommandBuffers(&allocInfo, &frame.command_buffer) != VK_SUCCESS)
         {
-            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to record command buffer");
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to allocate command buffers");
             return true;
         }
+
+        frame.descriptor_set = data.descriptor_set;
+        frame.uniform_offset = i * data.uniforms_per_frame * data.uniform_stride;
+        frame.instance_offset = static_cast<uint32_t>(i * data.instances_per_frame);
     }
     return false;
 }
 
-bool create_sync_objects(VulkanContext& ctx, RenderData& data)
+void destroy_frame_contexts(VulkanContext& ctx, RenderData& data)
 {
-    data.available_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    data.finished_semaphore.resize(MAX_FRAMES_IN_FLIGHT);
-    data.in_flight_fences.resize(MAX_FRAMES_IN_FLIGHT);
-    data.image_in_flight.resize(ctx.swapchain.image_count, VK_NULL_HANDLE);
-
-    VkSemaphoreCreateInfo semaphore_info = {};
-    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-    VkFenceCreateInfo fence_info = {};
-    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        if (ctx.disp.createSemaphore(&semaphore_info, nullptr, &data.available_semaphores[i]) != VK_SUCCESS ||
-            ctx.disp.createSemaphore(&semaphore_info, nullptr, &data.finished_semaphore[i]) != VK_SUCCESS ||
-            ctx.disp.createFence(&fence_info, nullptr, &data.in_flight_fences[i]) != VK_SUCCESS)
+    for (auto& frame : data.frames)
+    {
+        ctx.disp.destroySemaphore(frame.finished_semaphore, nullptr);
+        ctx.disp.destroySemaphore(frame.available_semaphore, nullptr);
+        ctx.disp.destroyFence(frame.in_flight_fence, nullptr);
+        ctx.disp.destroyCommandPool(frame.command_pool, nullptr);
+        for (auto buffer : frame.transient_buffers)
         {
-            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create sync objects");
-            return true;
+            delete buffer;
+        }
+        for (auto pipeline : frame.transient_pipelines)
+        {
+            ctx.disp.destroyPipeline(pipeline, nullptr);
         }
     }
-    return false;
+    data.frames.clear();
 }
 
-void copyBuffer(VulkanContext& ctx, RenderData& data, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+// Runs once per frame, after the frame's transient buffers were freed
+void update_memory_budgets(RenderData& data)
 {
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = ctx.command_pool;
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(ctx.device.device, &allocInfo, &commandBuffer);
-
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-    VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = 0; // Optional
-    copyRegion.dstOffset = 0; // Optional
-    copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-    vkEndCommandBuffer(commandBuffer);
-
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-
-    vkQueueSubmit(ctx.graphics_queue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(ctx.graphics_queue);
-
-    vkFreeCommandBuffers(ctx.device.device, ctx.command_pool, 1, &commandBuffer);
+    updateAllocatorBudgets(data.frame_number, data.heap_budgets);
+    for (size_t heap = 0; heap < data.heap_budgets.size(); heap++)
+    {
+        const HeapBudget& budget = data.heap_budgets[heap];
+        uint32_t bit = 1u << heap;
+        bool over = budget.budget > 0 && budget.usage > budget.budget * MEMORY_BUDGET_WARNING;
+        if (over && (data.heaps_over_budget & bit) == 0)
+        {
+            SDL_LogWarn(SDL_LOG_CATEGORY_VIDEO, "memory heap %zu uses %llu of its %llu MiB budget", heap,
+                        static_cast<unsigned long long>(budget.usage >> 20),
+                        static_cast<unsigned long long>(budget.budget >> 20));
+        }
+        data.heaps_over_budget = over ? data.heaps_over_budget | bit : data.heaps_over_budget & ~bit;
+    }
 }
 
-bool create_gpu_buffer(VulkanContext& ctx, BufferType type, Buffer** buffer, const void *content, uint32_t number_of_elements, size_t size_per_element)
+// Makes the current frame's resources available to the CPU. Waits for the
+// GPU to finish the frame's previous use, which only blocks when the CPU is
+// frames_in_flight frames ahead.
+bool acquire_frame(VulkanContext& ctx, RenderData& data)
 {
-    size_t buffer_size = number_of_elements * size_per_element;
-    // Creating the staging buffer
-    Buffer* staging_buffer;
-    try
-    {
-        staging_buffer = new Buffer(BufferType::StagingBuffer, number_of_elements, size_per_element);
-    }
-    catch(const std::runtime_error& e)
+    FrameContext& frame = data.frames[data.current_frame];
+    if (frame.acquired)
     {
-        return true;
+        return false;
     }
- 
-    // Creating the actual buffer
-    try
+
     {
-        *buffer = new Buffer(type, number_of_elements, size_per_element);
+        TRACE_ZONE("fence wait");
+        auto start = std::chrono::steady_clock::now();
+        if (ctx.disp.waitForFences(1, &frame.in_flight_fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to wait for frame fence");
+            return true;
+        }
+        frame.fence_wait = elapsed_ms(start);
     }
-    catch(const std::exception& e)
+
+    for (auto buffer : frame.transient_buffers)
     {
-        delete staging_buffer;
-        return true;
+        delete buffer;
     }
-
-    // Copying it to staging buffer
-    if (staging_buffer->copyToStagingBuffer(content, buffer_size))
+    frame.transient_buffers.clear();
+    for (auto pipeline : frame.transient_pipelines)
     {
-        delete *buffer;
-        delete staging_buffer;
-        buffer = nullptr;
-        return true;
+        ctx.disp.destroyPipeline(pipeline, nullptr);
     }
-
-    // Copying it to GPU buffer
-    if (Buffer::copyTo(ctx, *staging_buffer, **buffer))
+    frame.transient_pipelines.clear();
+    frame.uniform_count = 0;
+    frame.draws.clear();
+    for (auto mesh : frame.transient_meshes)
     {
-        delete *buffer;
-        delete staging_buffer;
-        buffer = nullptr;
-        return true;
+        data.meshes->remove(mesh);
     }
-
-    delete staging_buffer;
-
+    frame.transient_meshes.clear();
+    frame.instance_count = 0;
+    frame.instanced_draws.clear();
+    update_memory_budgets(data);
+    frame.acquired = true;
     return false;
 }
 
+// Hands the submitted frame back to the GPU and moves to the next slot
+void release_frame(RenderData& data)
+{
+    data.frames[data.current_frame].acquired = false;
+    data.last_frame = data.current_frame;
+    data.frame_number++;
+    data.current_frame = (data.current_frame + 1) % data.frames_in_flight;
+}
 
-
-bool recreate_swapchain(VulkanContext& ctx, RenderData& data, uint32_t width, uint32_t height)
+bool create_secondary_command_pools(VulkanContext& ctx, RenderData& data, uint32_t thread_count)
 {
-    ctx.disp.deviceWaitIdle();
+    data.job_system = new JobSystem(thread_count);
+    uint32_t partitions = data.job_system->getThreadCount();
 
-    ctx.disp.destroyCommandPool(ctx.command_pool, nullptr);
+    VkCommandPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    pool_info.queueFamilyIndex = ctx.device.get_queue_index(vkb::QueueType::graphics).value();
 
-    for (auto framebuffer : data.framebuffers)
+    // One pool per partition so no two workers ever record from the same pool
+    for (auto& frame : data.frames)
     {
-        ctx.disp.destroyFramebuffer(framebuffer, nullptr);
+        frame.secondary_command_pools.resize(partitions);
+        frame.secondary_command_buffers.resize(partitions);
+        for (uint32_t p = 0; p < partitions; p++)
+        {
+            if (ctx.disp.createCommandPool(&pool_info, nullptr, &frame.secondary_command_pools[p]) != VK_SUCCESS)
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create secondary command pool");
+                return true;
+            }
+
+            VkCommandBufferAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = frame.secondary_command_pools[p];
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 1;
+
+            if (ctx.disp.allocateCommandBuffers(&allocInfo, &frame.secondary_command_buffers[p]) != VK_SUCCESS)
+            {
+                SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to allocate secondary command buffer");
+                return true;
+            }
+        }
     }
-
-    ctx.swapchain.destroy_image_views(data.swapchain_image_views);
-
-    if (create_swapchain(ctx, width, height))  return true;
-    if (create_framebuffers(ctx, data))        return true;
-    if (create_command_pool(ctx, data))        return true;
-    // if (record_command_buffers(ctx, data, m_index_buffer, 6))  return true; //TODO FIX
     return false;
 }
 
+void destroy_secondary_command_pools(VulkanContext& ctx, RenderData& data)
+{
+    // Joins the workers before their pools go away
+    delete data.job_system;
+    data.job_system = nullptr;
+
+    for (auto& frame : data.frames)
+    {
+        for (auto pool : frame.secondary_command_pools)
+        {
+            ctx.disp.destroyCommandPool(pool, nullptr);
+        }
+        frame.secondary_command_pools.clear();
+        frame.secondary_command_buffers.clear();
+    }
+}
+
+void set_viewport_and_scissor(VulkanContext& ctx, VkCommandBuffer command_buffer)
+{
+    VkViewport viewport = {};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = (float)ctx.extent.width;
+    viewport.height = (float)ctx.extent.height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor = {};
+    scissor.offset = { 0, 0 };
+    scissor.extent = ctx.extent;
+
+    ctx.disp.cmdSetViewport(command_buffer, 0, 1, &viewport);
+    ctx.disp.cmdSetScissor(command_buffer, 0, 1, &scissor);
+}
+
+// Draws the objects that survived this frame's culling pass
+void record_culled_draws(VulkanContext& ctx, RenderData& data, VkCommandBuffer command_buffer, VkPipeline pipeline)
+{
+    FrameContext& frame = data.frames[data.current_frame];
+    VkDeviceSize offset = 0;
+    ctx.disp.cmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    ctx.disp.cmdBindVertexBuffers(command_buffer, 0, 1, &data.vertex_buffer->getBuffer(), &offset);
+    ctx.disp.cmdBindIndexBuffer(command_buffer, data.index_buffer->getBuffer(), 0, data.index_buffer->getIndexType());
+    ctx.disp.cmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, data.culling->getDrawLayout(), 0, 1, &frame.descriptor_set, 1, &frame.default_uniform_offset);
+    data.culling->recordDraw(command_buffer, data.current_frame);
+}
+
+// Number of draws recorded this frame: the queued draws, or draw_count
+// copies of the single mesh using the frame's default uniform when nothing
+// was queued. None while the pipeline is still compiling
+uint32_t frame_draw_count(RenderData& data)
+{
+    FrameContext& frame = data.frames[data.current_frame];
+    if (data.graphics_pipeline == VK_NULL_HANDLE)
+    {
+        return 0;
+    }
+    if (!frame.draws.empty())
+    {
+        return static_cast<uint32_t>(frame.draws.size());
+    }
+    bool has_mesh = data.vertex_buffer != nullptr && data.index_buffer != nullptr;
+    return has_mesh && frame.instanced_draws.empty() ? data.draw_count : 0;
+}
+
+// Whether this frame has instanced draws and their pipeline is ready
+bool has_instanced_draws(RenderData& data)
+{
+    return data.instanced_graphics_pipeline != VK_NULL_HANDLE && !data.frames[data.current_frame].instanced_draws.empty();
+}
+
+// Issues the frame's instanced draws, one per drawInstanced call
+void record_instanced_draws(VulkanContext& ctx, RenderData& data, VkCommandBuffer command_buffer)
+{
+    FrameContext& frame = data.frames[data.current_frame];
+    VkBuffer vertex_buffers[] = { data.vertex_buffer->getBuffer(), data.instance_buffer->getBuffer() };
+    VkDeviceSize offsets[] = { 0, 0 };
+    ctx.disp.cmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, data.instanced_graphics_pipeline);
+    ctx.disp.cmdBindVertexBuffers(command_buffer, 0, 2, vertex_buffers, offsets);
+    ctx.disp.cmdBindIndexBuffer(command_buffer, data.index_buffer->getBuffer(), 0, data.index_buffer->getIndexType());
+
+    for (const InstancedDraw& draw : frame.instanced_draws)
+    {
+        ctx.disp.cmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, data.pipeline_layout, 0, 1, &frame.descriptor_set, 1, &draw.uniform_offset);
+        ctx.disp.cmdDrawIndexed(command_buffer, data.index_buffer->getNumberOfElements(), draw.instance_count, 0, 0, draw.first_instance);
+    }
+}
+
+// Buffers and index range a draw reads its mesh from
+struct DrawGeometry {
+    VkBuffer vertex_buffer = VK_NULL_HANDLE;
+    VkBuffer index_buffer = VK_NULL_HANDLE;
+    VkIndexType index_type = VK_INDEX_TYPE_UINT16;
+    MeshRange range;
+};
+
+// The single mesh from createVertexBuffer / createIndicesBuffer
+DrawGeometry single_mesh_geometry(RenderData& data)
+{
+    DrawGeometry geometry;
+    geometry.vertex_buffer = data.vertex_buffer->getBuffer();
+    geometry.index_buffer = data.index_buffer->getBuffer();
+    geometry.index_type = data.index_buffer->getIndexType();
+    geometry.range.index_count = data.index_buffer->getNumberOfElements();
+    return geometry;
+}
+
+// Binds the mesh state and issues draws [first_draw, first_draw + draw_count).
+// Registered meshes share their vertex and index buffers, which are only
+// rebound when consecutive draws read different ones.
+void record_draws(VulkanContext& ctx, RenderData& data, VkCommandBuffer command_buffer, uint32_t first_draw, uint32_t draw_count)
+{
+    FrameContext& frame = data.frames[data.current_frame];
+    ctx.disp.cmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, data.graphics_pipeline);
+
+    BindlessDrawConstants constants = {};
+    constants.uniform_buffer = data.uniform_buffer_index;
+    VkShaderStageFlags stages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    if (data.bindless != nullptr)
+    {
+        // One bind for the whole command buffer, draws only push indices
+        ctx.disp.cmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, data.pipeline_layout, 0, 1, &frame.descriptor_set, 0, nullptr);
+    }
+
+    VkBuffer bound_vertices = VK_NULL_HANDLE;
+    VkBuffer bound_indices = VK_NULL_HANDLE;
+    auto bind_geometry = [&](const DrawGeometry& geometry) {
+        VkDeviceSize offset = 0;
+        if (geometry.vertex_buffer != bound_vertices)
+        {
+            ctx.disp.cmdBindVertexBuffers(command_buffer, 0, 1, &geometry.vertex_buffer, &offset);
+            bound_vertices = geometry.vertex_buffer;
+        }
+        if (geometry.index_buffer != bound_indices)
+        {
+            ctx.disp.cmdBindIndexBuffer(command_buffer, geometry.index_buffer, 0, geometry.index_type);
+            bound_indices = geometry.index_buffer;
+        }
+    };
+
+    if (frame.draws.empty())
+    {
+        DrawGeometry geometry = single_mesh_geometry(data);
+        bind_geometry(geometry);
+        if (data.bindless != nullptr)
+        {
+            constants.uniform_index = static_cast<uint32_t>(frame.default_uniform_offset / data.uniform_stride);
+            ctx.disp.cmdPushConstants(command_buffer, data.pipeline_layout, stages, 0, sizeof(constants), &constants);
+        }
+        else
+        {
+            ctx.disp.cmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, data.pipeline_layout, 0, 1, &frame.descriptor_set, 1, &frame.default_uniform_offset);
+        }
+        for (uint32_t draw = first_draw; draw < first_draw + draw_count; draw++)
+        {
+            ctx.disp.cmdDrawIndexed(command_buffer, geometry.range.index_count, 1, 0, 0, 0);
+        }
+        return;
+    }
+
+    for (uint32_t draw = first_draw; draw < first_draw + draw_count; draw++)
+    {
+        const MeshDraw& mesh_draw = frame.draws[draw];
+        DrawGeometry geometry;
+        if (mesh_draw.mesh != INVALID_MESH)
+        {
+            geometry.range = data.meshes->getRange(mesh_draw.mesh);
+            geometry.vertex_buffer = data.meshes->getVertexBuffer();
+            geometry.index_type = geometry.range.index_type;
+            geometry.index_buffer = data.meshes->getIndexBuffer(geometry.index_type);
+        }
+        else if (data.vertex_buffer != nullptr && data.index_buffer != nullptr)
+        {
+            geometry = single_mesh_geometry(data);
+        }
+        else
+        {
+            // Queued before the single mesh was uploaded
+            continue;
+        }
+        bind_geometry(geometry);
+
+        if (data.bindless != nullptr)
+        {
+            constants.uniform_index = static_cast<uint32_t>(mesh_draw.uniform_offset / data.uniform_stride);
+            ctx.disp.cmdPushConstants(command_buffer, data.pipeline_layout, stages, 0, sizeof(constants), &constants);
+        }
+        else
+        {
+            ctx.disp.cmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, data.pipeline_layout, 0, 1, &frame.descriptor_set, 1, &mesh_draw.uniform_offset);
+        }
+        ctx.disp.cmdDrawIndexed(command_buffer, geometry.range.index_count, 1, geometry.range.first_index, geometry.range.vertex_offset, 0);
+    }
+}
+
+// Splits the frame's draws across the job system, one secondary command buffer per partition.
+// The instanced draws go to the first partition. Returns the secondary buffers that hold
+// draws in executed.
+bool record_secondary_command_buffers(VulkanContext& ctx, RenderData& data, uint32_t image_index, std::vector<VkCommandBuffer>& executed)
+{
+    std::vector<VkCommandPool>& pools = data.frames[data.current_frame].secondary_command_pools;
+    std::vector<VkCommandBuffer>& buffers = data.frames[data.current_frame].secondary_command_buffers;
+    uint32_t partitions = static_cast<uint32_t>(buffers.size());
+    uint32_t total_draws = frame_draw_count(data);
+    uint32_t draws_per_partition = (total_draws + partitions - 1) / partitions;
+    bool instanced = has_instanced_draws(data);
+
+    VkCommandBufferInheritanceInfo inheritance_info = {};
+    inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance_info.renderPass = data.render_pass;
+    inheritance_info.subpass = 0;
+    inheritance_info.framebuffer = data.framebuffers[image_index];
+
+    std::vector<uint8_t> failed(partitions, 0);
+    data.job_system->parallelFor(partitions, [&](uint32_t p) {
+        uint32_t first_draw = std::min(p * draws_per_partition, total_draws);
+        uint32_t draw_count = std::min(draws_per_partition, total_draws - first_draw);
+        bool record_instanced = instanced && p == 0;
+        if (draw_count == 0 && !record_instanced)
+        {
+            return;
+        }
+        TRACE_ZONE("record partition");
+
+        if (ctx.disp.resetCommandPool(pools[p], 0) != VK_SUCCESS)
+        {
+            failed[p] = 1;
+            return;
+        }
+
+        VkCommandBufferBeginInfo begin_info = {};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        begin_info.pInheritanceInfo = &inheritance_info;
+
+        if (ctx.disp.beginCommandBuffer(buffers[p], &begin_info) != VK_SUCCESS)
+        {
+            failed[p] = 1;
+            return;
+        }
+        // Dynamic state is not inherited from the primary
+        set_viewport_and_scissor(ctx, buffers[p]);
+        if (draw_count > 0)
+        {
+            record_draws(ctx, data, buffers[p], first_draw, draw_count);
+        }
+        if (record_instanced)
+        {
+            record_instanced_draws(ctx, data, buffers[p]);
+        }
+        if (ctx.disp.endCommandBuffer(buffers[p]) != VK_SUCCESS)
+        {
+            failed[p] = 1;
+        }
+    });
+
+    executed.clear();
+    for (uint32_t p = 0; p < partitions; p++)
+    {
+        if (failed[p])
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to record secondary command buffer %u", p);
+            return true;
+        }
+        if (p * draws_per_partition < total_draws || (instanced && p == 0))
+        {
+            executed.push_back(buffers[p]);
+        }
+    }
+    return false;
+}
+
+bool create_gpu_profiler(VulkanContext& ctx, RenderData& data)
+{
+    try
+    {
+        data.profiler = new GpuProfiler(ctx, data.frames_in_flight);
+    }
+    catch(const std::runtime_error& e)
+    {
+        // Not fatal, the renderer just runs without GPU timings
+        SDL_LogWarn(SDL_LOG_CATEGORY_VIDEO, "gpu profiling disabled: %s", e.what());
+        return false;
+    }
+    data.frame_scope = data.profiler->getScope("frame");
+    data.cull_scope = data.profiler->getScope("cull");
+    data.pass_scope = data.profiler->getScope("main pass");
+    return false;
+}
+
+void profile_begin(RenderData& data, VkCommandBuffer command_buffer, uint32_t scope)
+{
+    if (data.profiler != nullptr)
+    {
+        data.profiler->beginScope(command_buffer, scope);
+    }
+}
+
+void profile_end(RenderData& data, VkCommandBuffer command_buffer)
+{
+    if (data.profiler != nullptr)
+    {
+        data.profiler->endScope(command_buffer);
+    }
+}
+
+// Records the current frame's command buffer targeting framebuffers[image_index].
+// The frame must be acquired, the whole pool is reset here.
+bool record_command_buffer(VulkanContext& ctx, RenderData& data, uint32_t image_index)
+{
+    TRACE_ZONE("record");
+    FrameContext& frame = data.frames[data.current_frame];
+    VkCommandBuffer command_buffer = frame.command_buffer;
+
+    if (ctx.disp.resetCommandPool(frame.command_pool, 0) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to reset frame command pool");
+        return true;
+    }
+
+    VkCommandBufferBeginInfo begin_info = {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (ctx.disp.beginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to begin recording command buffer");
+        return true;
+    }
+
+    // The frame's fence has signaled, so its previous timestamps are ready
+    if (data.profiler != nullptr)
+    {
+        data.profiler->beginFrame(command_buffer, static_cast<uint32_t>(data.current_frame));
+        data.last_timings.gpu = data.profiler->getScopeStats(data.frame_scope).last;
+        data.profiler->beginScope(command_buffer, data.frame_scope);
+    }
+
+    VkRenderPassBeginInfo render_pass_info = {};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    render_pass_info.renderPass = data.render_pass;
+    render_pass_info.framebuffer = data.framebuffers[image_index];
+    render_pass_info.renderArea.offset = { 0, 0 };
+    render_pass_info.renderArea.extent = ctx.extent;
+    VkClearValue clearColor{ { { 0.0f, 0.0f, 0.0f, 1.0f } } };
+    render_pass_info.clearValueCount = 1;
+    render_pass_info.pClearValues = &clearColor;
+
+    // Nothing uploaded or the pipeline still compiling: the pass still runs
+    // so the target gets cleared
+    data.graphics_pipeline = data.pipeline_manager->tryGet(data.mesh_pipeline);
+    bool has_mesh = data.vertex_buffer != nullptr && data.index_buffer != nullptr;
+    data.instanced_graphics_pipeline = VK_NULL_HANDLE;
+    if (has_mesh && data.instance_buffer != nullptr)
+    {
+        data.instanced_graphics_pipeline = data.pipeline_manager->tryGet(data.instanced_pipeline);
+    }
+
+    VkPipeline indirect_pipeline = VK_NULL_HANDLE;
+    if (has_mesh && data.graphics_pipeline != VK_NULL_HANDLE && data.culling != nullptr && data.culling->getObjectCount() > 0)
+    {
+        indirect_pipeline = data.pipeline_manager->tryGet(data.indirect_pipeline);
+    }
+
+    if (indirect_pipeline != VK_NULL_HANDLE)
+    {
+        // The culling dispatch has to run outside the render pass
+        profile_begin(data, command_buffer, data.cull_scope);
+        data.culling->recordCull(command_buffer, data.current_frame, frame.view_proj, data.index_buffer->getNumberOfElements());
+        profile_end(data, command_buffer);
+
+        set_viewport_and_scissor(ctx, command_buffer);
+        profile_begin(data, command_buffer, data.pass_scope);
+        ctx.disp.cmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+        record_culled_draws(ctx, data, command_buffer, indirect_pipeline);
+    }
+    else if (data.job_system != nullptr && (frame_draw_count(data) > 0 || has_instanced_draws(data)))
+    {
+        std::vector<VkCommandBuffer> secondary_buffers;
+        if (record_secondary_command_buffers(ctx, data, image_index, secondary_buffers)) return true;
+
+        profile_begin(data, command_buffer, data.pass_scope);
+        ctx.disp.cmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        ctx.disp.cmdExecuteCommands(command_buffer, static_cast<uint32_t>(secondary_buffers.size()), secondary_buffers.data());
+    }
+    else
+    {
+        set_viewport_and_scissor(ctx, command_buffer);
+        profile_begin(data, command_buffer, data.pass_scope);
+        ctx.disp.cmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+        if (frame_draw_count(data) > 0)
+        {
+            record_draws(ctx, data, command_buffer, 0, frame_draw_count(data));
+        }
+        if (has_instanced_draws(data))
+        {
+            record_instanced_draws(ctx, data, command_buffer);
+        }
+    }
+
+    ctx.disp.cmdEndRenderPass(command_buffer);
+    profile_end(data, command_buffer);
+    if (data.profiler != nullptr)
+    {
+        // Closes the frame scope
+        data.profiler->endFrame(command_buffer);
+    }
+
+    if (ctx.disp.endCommandBuffer(command_buffer) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to record command buffer");
+        return true;
+    }
+    return false;
+}
+
+bool create_upload_manager(VulkanContext& ctx, RenderData& data)
+{
+    try
+    {
+        data.upload_manager = new UploadManager(ctx, STAGING_RING_SIZE);
+    }
+    catch(const std::runtime_error& e)
+    {
+        return true;
+    }
+
+    if (data.upload_manager->isDedicated())
+    {
+        uint32_t graphics_family = ctx.device.get_queue_index(vkb::QueueType::graphics).value();
+        Buffer::setSharedQueueFamilies({ graphics_family, data.upload_manager->getQueueFamily() });
+    }
+    return false;
+}
+
+bool create_mesh_registry(VulkanContext& ctx, RenderData& data, uint32_t vertex_capacity, uint32_t index_capacity)
+{
+    size_t vertex_stride = ctx.compact_vertices ? sizeof(CompactVertex) : sizeof(Vertex);
+    try
+    {
+        data.meshes = new MeshRegistry(*data.upload_manager, vertex_capacity, index_capacity, vertex_stride);
+    }
+    catch(const std::runtime_error& e)
+    {
+        return true;
+    }
+    return false;
+}
+
+bool create_asset_streamer(VulkanContext& ctx, RenderData& data, uint32_t thread_count, uint32_t budget)
+{
+    if (thread_count == 0)
+    {
+        return false;
+    }
+    data.streamer = new AssetStreamer(thread_count, data.optimize_meshes, ctx.compact_vertices,
+                                      ctx.device.physical_device.properties.limits.maxDrawIndexedIndexValue);
+    data.stream_budget = budget;
+    return false;
+}
+
+// Adds the mesh in the registry's vertex format, quantizing it first when
+// the vertex buffers hold compact vertices
+template<typename Index>
+bool add_mesh(VulkanContext& ctx, RenderData& data, const std::vector<Vertex>& vertices, const std::vector<Index>& indices, MeshHandle& mesh, UploadTicket* ticket)
+{
+    if (ctx.compact_vertices)
+    {
+        std::vector<CompactVertex> compact;
+        quantize_vertices(vertices, compact);
+        mesh = data.meshes->add(compact.data(), static_cast<uint32_t>(compact.size()), indices, ticket);
+    }
+    else
+    {
+        mesh = data.meshes->add(vertices.data(), static_cast<uint32_t>(vertices.size()), indices, ticket);
+    }
+    return mesh == INVALID_MESH;
+}
+
+// Creates the GPU buffer and queues its upload, the copy runs asynchronously
+// and frames wait for it on the GPU through the upload timeline semaphore
+bool create_gpu_buffer(VulkanContext& ctx, RenderData& data, BufferType type, Buffer** buffer, const void *content, uint32_t number_of_elements, size_t size_per_element, UploadTicket* ticket)
+{
+    size_t buffer_size = number_of_elements * size_per_element;
+    // The replaced buffer may still be read by frames in flight
+    if (*buffer != nullptr)
+    {
+        if (acquire_frame(ctx, data)) return true;
+        data.frames[data.current_frame].transient_buffers.push_back(*buffer);
+        *buffer = nullptr;
+    }
+
+    // Creating the actual buffer
+    try
+    {
+        *buffer = new Buffer(type, number_of_elements, size_per_element);
+    }
+    catch(const std::exception& e)
+    {
+        return true;
+    }
+
+    // Staged through the persistent ring, no per-upload staging buffer
+    UploadTicket upload_ticket = data.upload_manager->upload(content, buffer_size, (*buffer)->getBuffer());
+    if (upload_ticket == 0)
+    {
+        delete *buffer;
+        *buffer = nullptr;
+        return true;
+    }
+
+    if (ticket != nullptr)
+    {
+        *ticket = upload_ticket;
+    }
+    return false;
+}
+
+bool recreate_swapchain(VulkanContext& ctx, RenderData& data, uint32_t width, uint32_t height)
+{
+    ctx.disp.deviceWaitIdle();
+
+    for (auto framebuffer : data.framebuffers)
+    {
+        ctx.disp.destroyFramebuffer(framebuffer, nullptr);
+    }
+
+    destroy_render_targets(ctx, data);
+
+    // Command buffers are recorded every frame, nothing to re-record here
+    if (create_swapchain(ctx, width, height))  return true;
+    if (create_framebuffers(ctx, data))        return true;
+    return false;
+}
+
+bool create_shader_watcher(RenderData& data)
+{
+    try
+    {
+        data.shader_watcher = new ShaderWatcher(SHADER_FOLDER);
+    }
+    catch(const std::runtime_error& e)
+    {
+        // Not fatal, the renderer just runs without hot reload
+        SDL_LogWarn(SDL_LOG_CATEGORY_VIDEO, "shader hot reload disabled: %s", e.what());
+    }
+    return false;
+}
+
+// Runs at the start of a frame, before recording. Changed shaders are
+// reloaded and their pipelines rebuilt in the background, rebuilt pipelines
+// are swapped in here. The pipelines they replace may still be used by
+// frames in flight, so they are destroyed when this frame is next acquired.
+void apply_shader_reloads(RenderData& data)
+{
+    if (data.shader_watcher == nullptr)
+    {
+        return;
+    }
+
+    for (const std::string& name : data.shader_watcher->poll())
+    {
+        if (data.shader_library->reload(name))
+        {
+            SDL_LogInfo(SDL_LOG_CATEGORY_VIDEO, "reloading pipelines using %s", name.c_str());
+            data.pipeline_manager->rebuild(name);
+        }
+    }
+    data.pipeline_manager->applyRebuilds(data.frames[data.current_frame].transient_pipelines);
+}
+
+// Runs at the start of a frame, before recording. Meshes decoded by the
+// streaming workers are copied into the upload batch this frame flushes,
+// the frame waits for that batch on the GPU so they can be drawn right away
+void apply_streamed_meshes(RenderData& data)
+{
+    if (data.streamer == nullptr)
+    {
+        return;
+    }
+    data.streamer->update(*data.meshes, data.stream_budget);
+}
+
+int draw_frame_headless(VulkanContext& ctx, RenderData& data)
+{
+    TRACE_ZONE("draw_frame");
+    FrameTimings& timings = data.last_timings;
+    timings = FrameTimings{};
+
+    if (acquire_frame(ctx, data)) return true;
+    FrameContext& frame = data.frames[data.current_frame];
+    timings.fence_wait = frame.fence_wait;
+    apply_shader_reloads(data);
+    apply_streamed_meshes(data);
+
+    // Offscreen images are cycled in order, there is nothing to acquire.
+    // Reusing an image is ordered on the queue by the render pass dependencies.
+    uint32_t image_index = data.offscreen_index;
+    data.offscreen_index = (data.offscreen_index + 1) % data.swapchain_images.size();
+
+    auto start = std::chrono::steady_clock::now();
+    if (record_command_buffer(ctx, data, image_index)) return true;
+    timings.record = elapsed_ms(start);
+
+    // Pending uploads go out first, the frame waits for them on the GPU
+    if (data.upload_manager->flush()) return true;
+    data.upload_manager->collect();
+
+    VkSemaphore upload_semaphore = data.upload_manager->getSemaphore();
+    uint64_t upload_value = data.upload_manager->getSubmittedTicket();
+    VkPipelineStageFlags upload_stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+    VkTimelineSemaphoreSubmitInfo timeline_info = {};
+    timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_info.waitSemaphoreValueCount = 1;
+    timeline_info.pWaitSemaphoreValues = &upload_value;
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timeline_info;
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = &upload_semaphore;
+    submitInfo.pWaitDstStageMask = &upload_stage;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &frame.command_buffer;
+
+    ctx.disp.resetFences(1, &frame.in_flight_fence);
+
+    {
+        TRACE_ZONE("submit");
+        start = std::chrono::steady_clock::now();
+        if (ctx.disp.queueSubmit(ctx.graphics_queue, 1, &submitInfo, frame.in_flight_fence) != VK_SUCCESS)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to submit draw command buffer");
+            return true;
+        }
+        timings.submit = elapsed_ms(start);
+    }
+
+    data.last_image_index = image_index;
+    release_frame(data);
+    return 0;
+}
+
 int draw_frame(VulkanContext& ctx, RenderData& data)
 {
-    ctx.disp.waitForFences(1, &data.in_flight_fences[data.current_frame], VK_TRUE, UINT64_MAX);
+    if (ctx.headless)
+    {
+        return draw_frame_headless(ctx, data);
+    }
+
+    TRACE_ZONE("draw_frame");
+    FrameTimings& timings = data.last_timings;
+    timings = FrameTimings{};
+
+    if (acquire_frame(ctx, data)) return true;
+    FrameContext& frame = data.frames[data.current_frame];
+    timings.fence_wait = frame.fence_wait;
+    apply_shader_reloads(data);
+    apply_streamed_meshes(data);
 
     uint32_t image_index = 0;
-    VkResult result = ctx.disp.acquireNextImageKHR(
-        ctx.swapchain, UINT64_MAX, data.available_semaphores[data.current_frame], VK_NULL_HANDLE, &image_index);
+    VkResult result;
+    auto start = std::chrono::steady_clock::now();
+    {
+        TRACE_ZONE("acquire");
+        result = ctx.disp.acquireNextImageKHR(
+            ctx.swapchain, UINT64_MAX, frame.available_semaphore, VK_NULL_HANDLE, &image_index);
+    }
+    timings.acquire = elapsed_ms(start);
 
     // Those do not work on SDL3 (Never get the signal)
     // if (result == VK_ERROR_OUT_OF_DATE_KHR)
@@ -710,77 +1489,204 @@ int draw_frame(VulkanContext& ctx, RenderData& data)
     //     return true;
     // }
 
-    if (data.image_in_flight[image_index] != VK_NULL_HANDLE)
-    {
-        ctx.disp.waitForFences(1, &data.image_in_flight[image_index], VK_TRUE, UINT64_MAX);
-    }
-    data.image_in_flight[image_index] = data.in_flight_fences[data.current_frame];
+    // Command buffers belong to the frame, not the image: an acquired image
+    // is already released by presentation, so there is no per-image fence to wait on
+
+    start = std::chrono::steady_clock::now();
+    if (record_command_buffer(ctx, data, image_index)) return true;
+    timings.record = elapsed_ms(start);
+
+    // Pending uploads go out first, the frame waits for them on the GPU
+    if (data.upload_manager->flush()) return true;
+    data.upload_manager->collect();
+
+    // The binary acquire semaphore ignores its value
+    uint64_t wait_values[] = { 0, data.upload_manager->getSubmittedTicket() };
+
+    VkTimelineSemaphoreSubmitInfo timeline_info = {};
+    timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_info.waitSemaphoreValueCount = 2;
+    timeline_info.pWaitSemaphoreValues = wait_values;
 
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timeline_info;
 
-    VkSemaphore wait_semaphores[] = { data.available_semaphores[data.current_frame] };
-    VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
+    VkSemaphore wait_semaphores[] = { frame.available_semaphore, data.upload_manager->getSemaphore() };
+    VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT };
+    submitInfo.waitSemaphoreCount = 2;
     submitInfo.pWaitSemaphores = wait_semaphores;
     submitInfo.pWaitDstStageMask = wait_stages;
 
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &data.command_buffers[image_index];
+    submitInfo.pCommandBuffers = &frame.command_buffer;
 
-    VkSemaphore signal_semaphores[] = { data.finished_semaphore[data.current_frame] };
+    VkSemaphore signal_semaphores[] = { frame.finished_semaphore };
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signal_semaphores;
 
-    ctx.disp.resetFences(1, &data.in_flight_fences[data.current_frame]);
+    ctx.disp.resetFences(1, &frame.in_flight_fence);
+
+    {
+        TRACE_ZONE("submit");
+        start = std::chrono::steady_clock::now();
+        if (ctx.disp.queueSubmit(ctx.graphics_queue, 1, &submitInfo, frame.in_flight_fence) != VK_SUCCESS)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to submit draw command buffer");
+            return true;
+        }
+        timings.submit = elapsed_ms(start);
+    }
+
+    VkPresentInfoKHR present_info = {};
+    present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+
+    present_info.waitSemaphoreCount = 1;
+    present_info.pWaitSemaphores = signal_semaphores;
+
+    VkSwapchainKHR swapChains[] = { ctx.swapchain };
+    present_info.swapchainCount = 1;
+    present_info.pSwapchains = swapChains;
+
+    present_info.pImageIndices = &image_index;
+
+    start = std::chrono::steady_clock::now();
+    {
+        TRACE_ZONE("present");
+        result = ctx.disp.queuePresentKHR(ctx.present_queue, &present_info);
+    }
+    timings.present = elapsed_ms(start);
+
+    // Those do not work on SDL3 (Never get the signal)
+    // if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)\
+    // {
+    //     return recreate_swapchain(ctx, data);
+    // }
+    // else if (result != VK_SUCCESS)
+    // {
+    //     SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to present swapchain image");
+    //     return true;
+    // }
+
+    data.last_image_index = image_index;
+    release_frame(data);
+    return 0;
+}
+
+bool read_frame(VulkanContext& ctx, RenderData& data, std::vector<uint8_t>& pixels)
+{
+    if (!ctx.headless || data.readback_buffer == nullptr)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "frame readback is only available in headless mode");
+        return true;
+    }
+
+    uint32_t image_index = data.last_image_index;
+    if (data.frame_number == 0)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "no frame has been drawn yet");
+        return true;
+    }
+    ctx.disp.waitForFences(1, &data.frames[data.last_frame].in_flight_fence, VK_TRUE, UINT64_MAX);
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = ctx.command_pool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (ctx.disp.allocateCommandBuffers(&allocInfo, &commandBuffer) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to allocate readback command buffer");
+        return true;
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    ctx.disp.beginCommandBuffer(commandBuffer, &beginInfo);
+
+    // The render pass leaves the image in TRANSFER_SRC_OPTIMAL
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = { ctx.extent.width, ctx.extent.height, 1 };
+    ctx.disp.cmdCopyImageToBuffer(commandBuffer, data.swapchain_images[image_index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                  data.readback_buffer->getBuffer(), 1, &region);
+    ctx.disp.endCommandBuffer(commandBuffer);
 
-    if (ctx.disp.queueSubmit(ctx.graphics_queue, 1, &submitInfo, data.in_flight_fences[data.current_frame]) != VK_SUCCESS)
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    bool failed = ctx.disp.queueSubmit(ctx.graphics_queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS;
+    ctx.disp.queueWaitIdle(ctx.graphics_queue);
+    ctx.disp.freeCommandBuffers(ctx.command_pool, 1, &commandBuffer);
+    if (failed)
     {
-        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to submit draw command buffer");
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to submit readback");
         return true;
     }
 
-    VkPresentInfoKHR present_info = {};
-    present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-
-    present_info.waitSemaphoreCount = 1;
-    present_info.pWaitSemaphores = signal_semaphores;
-
-    VkSwapchainKHR swapChains[] = { ctx.swapchain };
-    present_info.swapchainCount = 1;
-    present_info.pSwapchains = swapChains;
-
-    present_info.pImageIndices = &image_index;
-
-    result = ctx.disp.queuePresentKHR(ctx.present_queue, &present_info);
+    pixels.resize(data.readback_buffer->getSize());
+    return data.readback_buffer->copyFromReadbackBuffer(pixels.data(), pixels.size());
+}
 
-    // Those do not work on SDL3 (Never get the signal)
-    // if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)\
-    // {
-    //     return recreate_swapchain(ctx, data);
-    // }
-    // else if (result != VK_SUCCESS)
-    // {
-    //     SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to present swapchain image");
-    //     return true;
-    // }
 
-    data.current_frame = (data.current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
-    return 0;
+// Heap budgets, buffers per type and the allocator's own stats as one JSON
+// document
+void write_memory_stats(const RenderData& data, std::ostream& out, bool detailed)
+{
+    out << "{\n  \"heaps\": [";
+    for (size_t heap = 0; heap < data.heap_budgets.size(); heap++)
+    {
+        const HeapBudget& budget = data.heap_budgets[heap];
+        out << (heap == 0 ? "\n" : ",\n")
+            << "    { \"budget\": " << budget.budget
+            << ", \"usage\": " << budget.usage
+            << ", \"block_bytes\": " << budget.block_bytes
+            << ", \"allocation_bytes\": " << budget.allocation_bytes
+            << ", \"allocations\": " << budget.allocation_count
+            << ", \"device_local\": " << (budget.device_local ? "true" : "false") << " }";
+    }
+    out << "\n  ],\n  \"buffers\": {";
+    for (uint32_t type = 0; type < BUFFER_TYPE_COUNT; type++)
+    {
+        BufferTypeStats stats = Buffer::getTypeStats(static_cast<BufferType>(type));
+        out << (type == 0 ? "\n" : ",\n")
+            << "    \"" << buffer_type_name(static_cast<BufferType>(type)) << "\": {"
+            << " \"live\": " << stats.live_count
+            << ", \"live_bytes\": " << stats.live_bytes
+            << ", \"peak_bytes\": " << stats.peak_bytes
+            << ", \"created\": " << stats.created_count << " }";
+    }
+    out << "\n  },\n  \"vma\": " << buildAllocatorStatsString(detailed) << "\n}\n";
 }
 
+// Runs once everything the renderer allocated is destroyed, whatever is
+// left leaked
+void report_leaks()
+{
+    uint32_t live_buffers = Buffer::logLiveBuffers();
+    uint32_t live_allocations = getAllocationCount();
+    if (live_buffers > 0 || live_allocations > 0)
+    {
+        SDL_LogWarn(SDL_LOG_CATEGORY_VIDEO, "leaked %u buffers, %u allocations in total",
+                    live_buffers, live_allocations);
+    }
+}
 
 void cleanup(VulkanContext& ctx, RenderData& data)
 {
     VmaAllocator& allocator = getAllocator(); 
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-    {
-        ctx.disp.destroySemaphore(data.finished_semaphore[i], nullptr);
-        ctx.disp.destroySemaphore(data.available_semaphores[i], nullptr);
-        ctx.disp.destroyFence(data.in_flight_fences[i], nullptr);
-    }
-
+    // Its workers may still be decoding, none of them touch the GPU
+    delete data.streamer;
+    delete data.upload_manager;
+    destroy_secondary_command_pools(ctx, data);
+    destroy_frame_contexts(ctx, data);
     ctx.disp.destroyCommandPool(ctx.command_pool, nullptr);
 
     for (auto framebuffer : data.framebuffers)
@@ -788,30 +1694,53 @@ void cleanup(VulkanContext& ctx, RenderData& data)
         ctx.disp.destroyFramebuffer(framebuffer, nullptr);
     }
 
-    ctx.disp.destroyPipeline(data.graphics_pipeline, nullptr);
+    delete data.culling;
+    delete data.profiler;
+    delete data.shader_watcher;
+    delete data.pipeline_manager;
+    delete data.compile_jobs;
+    delete data.shader_library;
     ctx.disp.destroyPipelineLayout(data.pipeline_layout, nullptr);
+    if (data.pipeline_cache != nullptr)
+    {
+        data.pipeline_cache->save();
+        delete data.pipeline_cache;
+    }
     ctx.disp.destroyRenderPass(data.render_pass, nullptr);
 
-    ctx.swapchain.destroy_image_views(data.swapchain_image_views);
+    destroy_render_targets(ctx, data);
 
     delete data.vertex_buffer;
     delete data.index_buffer;
+    delete data.meshes;
 
     vkb::destroy_swapchain(ctx.swapchain);
 
-    for (auto ub : data.uniformBuffers)
+    delete data.uniform_buffer;
+    delete data.instance_buffer;
+
+    if (data.bindless != nullptr)
     {
-        delete ub;
+        delete data.bindless;
+    }
+    else
+    {
+        ctx.disp.destroyDescriptorPool(data.descriptor_pool, nullptr);
+        ctx.disp.destroyDescriptorSetLayout(data.descriptor_set_layout, nullptr);
     }
 
-    ctx.disp.destroyDescriptorPool(data.descriptor_pool, nullptr);
-    ctx.disp.destroyDescriptorSetLayout(data.descriptor_set_layout, nullptr);
-
+    report_leaks();
     destroyAllocator();
     vkb::destroy_device(ctx.device);
-    vkb::destroy_surface(ctx.instance, ctx.surface);
+    if (!ctx.headless)
+    {
+        vkb::destroy_surface(ctx.instance, ctx.surface);
+    }
     vkb::destroy_instance(ctx.instance);
-    destroy_window(ctx.window);
+    if (!ctx.headless)
+    {
+        destroy_window(ctx.window);
+    }
 }
 
 // End util function
@@ -829,12 +1758,39 @@ Renderer::~Renderer()
 
 bool Renderer::init(uint32_t width, uint32_t height)
 {
+    RendererConfig config;
+    config.width = width;
+    config.height = height;
+    return init(config);
+}
+
+bool Renderer::init(const RendererConfig& config)
+{
+    auto init_start = std::chrono::steady_clock::now();
+    uint32_t width = config.width;
+    uint32_t height = config.height;
+    m_ctx.headless = config.headless;
+    m_ctx.bindless = config.bindless;
+    m_ctx.gpu_culling = config.gpu_culling;
+    m_ctx.compact_vertices = config.compact_vertices;
+    m_render_data.frames_in_flight = config.frames_in_flight > 0 ? config.frames_in_flight : 1;
+    m_render_data.uniforms_per_frame = config.max_draws_per_frame > 0 ? config.max_draws_per_frame : 1;
+    m_render_data.instances_per_frame = config.max_instances_per_frame;
+    m_render_data.optimize_meshes = config.optimize_meshes;
+
     if (device_initialization(m_ctx, width, height)) return true;
 
     // Force allocator creation
-    createAllocator(m_ctx);
+    if (createAllocator(m_ctx))                                 return true;
 
-    if (create_swapchain            (m_ctx, width, height))     return true;
+    if (m_ctx.headless)
+    {
+        if (create_offscreen_images (m_ctx, m_render_data, width, height)) return true;
+    }
+    else
+    {
+        if (create_swapchain        (m_ctx, width, height))     return true;
+    }
     if (get_queues                  (m_ctx, m_render_data))     return true;
     if (create_render_pass          (m_ctx, m_render_data))     return true;
     if (create_descriptor_set_layout(m_ctx, m_render_data))     return true;
@@ -843,10 +1799,34 @@ bool Renderer::init(uint32_t width, uint32_t height)
     
     if (create_descriptor_pool      (m_ctx, m_render_data))     return true;
     if (create_descriptor_sets      (m_ctx, m_render_data))     return true;
-    if (create_graphics_pipeline    (m_ctx, m_render_data))     return true;
+    if (create_pipeline_cache       (m_ctx, m_render_data, config.pipeline_cache_path)) return true;
+    auto pipelines_start = std::chrono::steady_clock::now();
+    if (create_graphics_pipeline    (m_ctx, m_render_data, config.pipeline_compile_threads)) return true;
+    m_render_data.init_timings.pipelines = elapsed_ms(pipelines_start);
+    if (create_instancing           (m_ctx, m_render_data))     return true;
+    if (config.hot_reload_shaders)
+    {
+        if (create_shader_watcher   (m_render_data))            return true;
+    }
     if (create_framebuffers         (m_ctx, m_render_data))     return true;
     if (create_command_pool         (m_ctx, m_render_data))     return true;
-    if (create_sync_objects         (m_ctx, m_render_data))     return true;
+    if (create_frame_contexts       (m_ctx, m_render_data))     return true;
+    if (config.gpu_culling)
+    {
+        if (create_gpu_culling      (m_ctx, m_render_data, config.max_objects)) return true;
+    }
+    if (config.gpu_profiling)
+    {
+        if (create_gpu_profiler     (m_ctx, m_render_data))     return true;
+    }
+    if (config.recording_threads > 0)
+    {
+        if (create_secondary_command_pools(m_ctx, m_render_data, config.recording_threads)) return true;
+    }
+    if (create_upload_manager       (m_ctx, m_render_data))     return true;
+    if (create_mesh_registry        (m_ctx, m_render_data, config.mesh_vertex_capacity, config.mesh_index_capacity)) return true;
+    if (create_asset_streamer       (m_ctx, m_render_data, config.streaming_threads, config.stream_budget_bytes)) return true;
+    m_render_data.init_timings.total = elapsed_ms(init_start);
     return false;
 }
 
@@ -857,43 +1837,388 @@ bool Renderer::drawFrame()
 
 bool Renderer::updateUniformBuffer(const UniformBufferObject& ubo)
 {
-    void* data;
-    Buffer* uniformBuffer = m_render_data.uniformBuffers[m_render_data.current_frame];
-    uniformBuffer->copyToStagingBuffer(&ubo, sizeof(ubo));
+    uint32_t offset = 0;
+    if (pushUniform(ubo, offset))
+    {
+        return true;
+    }
+    FrameContext& frame = m_render_data.frames[m_render_data.current_frame];
+    frame.default_uniform_offset = offset;
+    frame.view_proj = ubo.proj * ubo.view;
+    return false;
+}
+
+bool Renderer::pushUniform(const UniformBufferObject& ubo, uint32_t& offset)
+{
+    RenderData& data = m_render_data;
+    // The slice may only be written once the GPU is done with the frame's previous use
+    if (acquire_frame(m_ctx, data))
+    {
+        return true;
+    }
+
+    FrameContext& frame = data.frames[data.current_frame];
+    if (frame.uniform_count >= data.uniforms_per_frame)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "uniform ring full, %u uniforms per frame", data.uniforms_per_frame);
+        return true;
+    }
+
+    VkDeviceSize ring_offset = frame.uniform_offset + frame.uniform_count * data.uniform_stride;
+    if (data.uniform_buffer->copyToStagingBuffer(&ubo, sizeof(ubo), ring_offset))
+    {
+        return true;
+    }
+
+    frame.uniform_count++;
+    offset = static_cast<uint32_t>(ring_offset);
+    return false;
+}
+
+void Renderer::drawMesh(uint32_t uniform_offset)
+{
+    if (acquire_frame(m_ctx, m_render_data))
+    {
+        return;
+    }
+    MeshDraw draw;
+    draw.mesh = INVALID_MESH;
+    draw.uniform_offset = uniform_offset;
+    m_render_data.frames[m_render_data.current_frame].draws.push_back(draw);
+}
+
+void Renderer::drawMesh(MeshHandle mesh, uint32_t uniform_offset)
+{
+    if (!m_render_data.meshes->isValid(mesh))
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "invalid mesh %u", mesh);
+        return;
+    }
+    if (acquire_frame(m_ctx, m_render_data))
+    {
+        return;
+    }
+    MeshDraw draw;
+    draw.mesh = mesh;
+    draw.uniform_offset = uniform_offset;
+    m_render_data.frames[m_render_data.current_frame].draws.push_back(draw);
+}
+
+bool Renderer::drawInstanced(const Instance* instances, uint32_t instance_count, uint32_t uniform_offset)
+{
+    RenderData& data = m_render_data;
+    if (data.instance_buffer == nullptr)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "instancing is disabled");
+        return true;
+    }
+    if (instance_count == 0)
+    {
+        return false;
+    }
+    if (acquire_frame(m_ctx, data))
+    {
+        return true;
+    }
+
+    FrameContext& frame = data.frames[data.current_frame];
+    if (instance_count > data.instances_per_frame - frame.instance_count)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "instance ring full, %u instances per frame", data.instances_per_frame);
+        return true;
+    }
+
+    uint32_t first_instance = frame.instance_offset + frame.instance_count;
+    if (data.instance_buffer->copyToStagingBuffer(instances, instance_count * sizeof(Instance), first_instance * sizeof(Instance)))
+    {
+        return true;
+    }
+    frame.instance_count += instance_count;
+
+    InstancedDraw draw;
+    draw.uniform_offset = uniform_offset;
+    draw.first_instance = first_instance;
+    draw.instance_count = instance_count;
+    frame.instanced_draws.push_back(draw);
     return false;
 }
 
 bool Renderer::resize()
 {
+    if (m_ctx.headless)
+    {
+        return false;
+    }
+
     int width, height;
     bool result = SDL_GetWindowSizeInPixels(m_ctx.window, &width, &height);
     return recreate_swapchain(m_ctx, m_render_data, width, height);
 }
 
-bool Renderer::createVertexBuffer(const std::vector<Vertex> &vertices)
+bool Renderer::readFrame(std::vector<uint8_t>& pixels)
+{
+    return read_frame(m_ctx, m_render_data, pixels);
+}
+
+bool Renderer::waitIdle()
+{
+    return m_ctx.disp.deviceWaitIdle() != VK_SUCCESS;
+}
+
+const FrameTimings& Renderer::getLastFrameTimings() const
 {
+    return m_render_data.last_timings;
+}
+
+const InitTimings& Renderer::getInitTimings() const
+{
+    return m_render_data.init_timings;
+}
+
+StreamRequest Renderer::streamMesh(const std::string& path)
+{
+    if (m_render_data.streamer == nullptr)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "mesh streaming is disabled");
+        return INVALID_STREAM_REQUEST;
+    }
+    return m_render_data.streamer->request(path);
+}
+
+StreamState Renderer::getStreamState(StreamRequest request)
+{
+    if (m_render_data.streamer == nullptr)
+    {
+        return StreamState::Failed;
+    }
+    return m_render_data.streamer->getState(request);
+}
+
+MeshHandle Renderer::getStreamedMesh(StreamRequest request)
+{
+    if (m_render_data.streamer == nullptr)
+    {
+        return INVALID_MESH;
+    }
+    return m_render_data.streamer->getMesh(request);
+}
+
+BindlessTable* Renderer::getBindlessTable()
+{
+    return m_render_data.bindless;
+}
+
+GpuProfiler* Renderer::getGpuProfiler()
+{
+    return m_render_data.profiler;
+}
+
+const std::vector<HeapBudget>& Renderer::getMemoryBudgets() const
+{
+    return m_render_data.heap_budgets;
+}
+
+bool Renderer::writeMemoryStats(const std::string& path, bool detailed)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open())
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to open %s", path.c_str());
+        return true;
+    }
+    write_memory_stats(m_render_data, file, detailed);
+    return !file.good();
+}
+
+bool Renderer::arePipelinesReady()
+{
+    RenderData& data = m_render_data;
+    if (data.culling != nullptr && !data.pipeline_manager->isReady(data.indirect_pipeline))
+    {
+        return false;
+    }
+    if (data.instance_buffer != nullptr && !data.pipeline_manager->isReady(data.instanced_pipeline))
+    {
+        return false;
+    }
+    return data.pipeline_manager->isReady(data.mesh_pipeline);
+}
+
+void Renderer::waitForPipelines()
+{
+    m_render_data.pipeline_manager->waitIdle();
+}
+
+void Renderer::setDrawCount(uint32_t draw_count)
+{
+    m_render_data.draw_count = draw_count;
+}
+
+bool Renderer::setObjects(const std::vector<GpuObject>& objects, UploadTicket* ticket)
+{
+    RenderData& data = m_render_data;
+    if (data.culling == nullptr)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "setObjects needs gpu_culling");
+        return true;
+    }
+    if (acquire_frame(m_ctx, data))
+    {
+        return true;
+    }
+
+    Buffer* retired = nullptr;
+    if (data.culling->setObjects(*data.upload_manager, objects, retired, ticket))
+    {
+        return true;
+    }
+    if (retired != nullptr)
+    {
+        data.frames[data.current_frame].transient_buffers.push_back(retired);
+    }
+    return false;
+}
+
+bool Renderer::createVertexBuffer(const std::vector<Vertex> &vertices, UploadTicket* ticket)
+{
+    if (m_ctx.compact_vertices)
+    {
+        std::vector<CompactVertex> compact;
+        quantize_vertices(vertices, compact);
+        return create_gpu_buffer(m_ctx, m_render_data, BufferType::VertexBuffer, &m_render_data.vertex_buffer, static_cast<const void*>(compact.data()), compact.size(), sizeof(compact[0]), ticket);
+    }
     // size_t buffer_size = sizeof(vertices[0]) * vertices.size();;
-    return create_gpu_buffer(m_ctx, BufferType::VertexBuffer, &m_render_data.vertex_buffer, static_cast<const void*>(vertices.data()), vertices.size(), sizeof(vertices[0]));
+    return create_gpu_buffer(m_ctx, m_render_data, BufferType::VertexBuffer, &m_render_data.vertex_buffer, static_cast<const void*>(vertices.data()), vertices.size(), sizeof(vertices[0]), ticket);
 }
 
-bool Renderer::createIndicesBuffer(const std::vector<uint16_t> &indices)
+bool Renderer::createIndicesBuffer(const std::vector<uint16_t> &indices, UploadTicket* ticket)
 {
     // size_t buffer_size = sizeof(indices[0]) * indices.size();
-    return create_gpu_buffer(m_ctx, BufferType::IndiceBuffer, &m_render_data.index_buffer, static_cast<const void*>(indices.data()), indices.size(), sizeof(indices[0]));
+    return create_gpu_buffer(m_ctx, m_render_data, BufferType::IndiceBuffer, &m_render_data.index_buffer, static_cast<const void*>(indices.data()), indices.size(), sizeof(indices[0]), ticket);
 }
 
-bool Renderer::createUniformBuffers(size_t buffer_size)
+bool Renderer::createIndicesBuffer(const std::vector<uint32_t>& indices, UploadTicket* ticket)
 {
-    m_render_data.uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    std::vector<uint16_t> narrowed;
+    if (narrow_indices(indices, narrowed))
     {
-        m_render_data.uniformBuffers[i] = new Buffer(BufferType::UniformBuffer, 1, buffer_size);
+        return createIndicesBuffer(narrowed, ticket);
     }
-    return false;
+
+    uint32_t limit = m_ctx.device.physical_device.properties.limits.maxDrawIndexedIndexValue;
+    if (max_index(indices) > limit)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "index %u above the device limit %u", max_index(indices), limit);
+        return true;
+    }
+    return create_gpu_buffer(m_ctx, m_render_data, BufferType::IndiceBuffer, &m_render_data.index_buffer, static_cast<const void*>(indices.data()), indices.size(), sizeof(indices[0]), ticket);
+}
+
+bool Renderer::createMesh(const std::vector<Vertex>& vertices, const std::vector<uint16_t>& indices, MeshHandle& mesh, UploadTicket* ticket)
+{
+    if (m_render_data.optimize_meshes)
+    {
+        // The optimizer works on 32 bit indices, the registry narrows them back
+        std::vector<uint32_t> wide_indices(indices.begin(), indices.end());
+        return createMesh(vertices, wide_indices, mesh, ticket);
+    }
+    return add_mesh(m_ctx, m_render_data, vertices, indices, mesh, ticket);
+}
+
+bool Renderer::createMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, MeshHandle& mesh, UploadTicket* ticket)
+{
+    if (m_render_data.optimize_meshes)
+    {
+        std::vector<Vertex> optimized_vertices = vertices;
+        std::vector<uint32_t> optimized_indices = indices;
+        optimize_mesh(optimized_vertices, optimized_indices);
+        return add_mesh(m_ctx, m_render_data, optimized_vertices, optimized_indices, mesh, ticket);
+    }
+    return add_mesh(m_ctx, m_render_data, vertices, indices, mesh, ticket);
+}
+
+bool Renderer::loadMesh(const std::string& path, MeshHandle& mesh, UploadTicket* ticket)
+{
+    mesh = INVALID_MESH;
+    try
+    {
+        MappedFile file(path);
+        MeshFileView view;
+        if (read_mesh_file(file.getData(), file.getSize(), view, m_ctx.device.physical_device.properties.limits.maxDrawIndexedIndexValue))
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to read %s", path.c_str());
+            return true;
+        }
+
+        const MeshFileHeader& header = *view.header;
+        if (m_ctx.compact_vertices ? view.hasLayout<CompactVertex>() : view.hasLayout<Vertex>())
+        {
+            // The upload copies the blobs into staging before the mapping goes away
+            mesh = m_render_data.meshes->add(view.vertices, header.vertex_count, view.indices, header.index_count, view.getIndexType(), ticket);
+        }
+        else if (m_ctx.compact_vertices && view.hasLayout<Vertex>())
+        {
+            const Vertex* vertices = static_cast<const Vertex*>(view.vertices);
+            std::vector<CompactVertex> compact;
+            quantize_vertices(std::vector<Vertex>(vertices, vertices + header.vertex_count), compact);
+            mesh = m_render_data.meshes->add(compact.data(), header.vertex_count, view.indices, header.index_count, view.getIndexType(), ticket);
+        }
+        else
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "%s vertex layout does not match the renderer's", path.c_str());
+            return true;
+        }
+    }
+    catch(const std::runtime_error& e)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to load %s: %s", path.c_str(), e.what());
+        return true;
+    }
+    return mesh == INVALID_MESH;
+}
+
+void Renderer::destroyMesh(MeshHandle mesh)
+{
+    if (acquire_frame(m_ctx, m_render_data))
+    {
+        return;
+    }
+    m_render_data.frames[m_render_data.current_frame].transient_meshes.push_back(mesh);
+}
+
+bool Renderer::isUploadComplete(UploadTicket ticket)
+{
+    return m_render_data.upload_manager->isComplete(ticket);
 }
 
+bool Renderer::waitForUpload(UploadTicket ticket)
+{
+    return m_render_data.upload_manager->wait(ticket);
+}
 
-bool Renderer::recordCommandBuffer()
+bool Renderer::createUniformBuffers(size_t buffer_size)
 {
-    return record_command_buffers(m_ctx, m_render_data);
+    // Every uniform starts on a dynamic offset the device accepts, bindless
+    // shaders index the ring as an array so only the std430 alignment matters
+    VkDeviceSize alignment = m_ctx.device.physical_device.properties.limits.minUniformBufferOffsetAlignment;
+    if (m_ctx.bindless)
+    {
+        alignment = 16;
+    }
+    alignment = std::max<VkDeviceSize>(alignment, 1);
+    m_render_data.uniform_stride = (buffer_size + alignment - 1) / alignment * alignment;
+
+    // One slice of uniforms_per_frame uniforms per frame in flight
+    try
+    {
+        m_render_data.uniform_buffer = new Buffer(BufferType::UniformBuffer,
+                                                  m_render_data.frames_in_flight * m_render_data.uniforms_per_frame,
+                                                  m_render_data.uniform_stride);
+    }
+    catch(const std::runtime_error& e)
+    {
+        return true;
+    }
+    return false;
 }
+
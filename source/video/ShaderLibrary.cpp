@@ -0,0 +1,143 @@
+#include "video/ShaderLibrary.h"
+
+#include <stdexcept>
+
+#include "core/MappedFile.h"
+#include "video/EmbeddedShaders.h"
+
+ShaderLibrary::ShaderLibrary(VulkanContext& ctx, const std::string& folder) : m_ctx(ctx), m_folder(folder)
+{
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+    for (auto& entry : m_modules)
+    {
+        m_ctx.disp.destroyShaderModule(entry.second, nullptr);
+    }
+}
+
+// FNV-1a, only used to tell binaries apart
+uint64_t ShaderLibrary::hash(const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+VkShaderModule ShaderLibrary::getModule(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto named = m_names.find(name);
+    if (named != m_names.end())
+    {
+        return m_modules[named->second];
+    }
+
+    uint64_t content_hash = 0;
+    VkShaderModule module = VK_NULL_HANDLE;
+
+#ifdef RENDERER_EMBED_SHADERS
+    for (size_t i = 0; i < EMBEDDED_SHADER_COUNT; i++)
+    {
+        if (name == EMBEDDED_SHADERS[i].name)
+        {
+            module = createModule(EMBEDDED_SHADERS[i].code, EMBEDDED_SHADERS[i].size, content_hash);
+            break;
+        }
+    }
+    if (module == VK_NULL_HANDLE)
+#endif
+    {
+        try
+        {
+            // pCode points straight into the mapping, no copy is made
+            MappedFile file(m_folder + "/" + name);
+            module = createModule(file.getData(), file.getSize(), content_hash);
+        }
+        catch(const std::exception& e)
+        {
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Failed to read shader %s", name.c_str());
+            return VK_NULL_HANDLE;
+        }
+    }
+
+    if (module != VK_NULL_HANDLE)
+    {
+        m_names[name] = content_hash;
+    }
+    return module;
+}
+
+bool ShaderLibrary::reload(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint64_t content_hash = 0;
+    VkShaderModule module = VK_NULL_HANDLE;
+    try
+    {
+        MappedFile file(m_folder + "/" + name);
+        module = createModule(file.getData(), file.getSize(), content_hash);
+    }
+    catch(const std::exception& e)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Failed to read shader %s", name.c_str());
+        return false;
+    }
+    if (module == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+
+    // Modules of previous versions stay alive, pipelines in flight may use
+    // them and reverting a change makes them current again
+    auto named = m_names.find(name);
+    bool changed = named == m_names.end() || named->second != content_hash;
+    m_names[name] = content_hash;
+    return changed;
+}
+
+// Returns the module already created for an identical binary if there is one
+VkShaderModule ShaderLibrary::createModule(const void* code, size_t size, uint64_t& content_hash)
+{
+    if (size == 0 || size % 4 != 0)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "SPIR-V size %zu is not a multiple of 4", size);
+        return VK_NULL_HANDLE;
+    }
+
+    content_hash = hash(code, size);
+    auto existing = m_modules.find(content_hash);
+    if (existing != m_modules.end())
+    {
+        return existing->second;
+    }
+
+    VkShaderModuleCreateInfo create_info = {};
+    create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    create_info.codeSize = size;
+    create_info.pCode = static_cast<const uint32_t*>(code);
+
+    VkShaderModule shaderModule;
+    if (m_ctx.disp.createShaderModule(&create_info, nullptr, &shaderModule) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "Failed to create shader module");
+        return VK_NULL_HANDLE;
+    }
+
+    m_modules.emplace(content_hash, shaderModule);
+    return shaderModule;
+}
+
+size_t ShaderLibrary::getModuleCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_modules.size();
+}
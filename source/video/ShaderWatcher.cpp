@@ -0,0 +1,85 @@
+#include "video/ShaderWatcher.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+
+ShaderWatcher::ShaderWatcher(const std::string& folder)
+{
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0)
+    {
+        throw std::runtime_error("failed to init inotify");
+    }
+
+    // Compilers write in place, editors usually rename a temporary over the file
+    m_watch = inotify_add_watch(m_fd, folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (m_watch < 0)
+    {
+        close(m_fd);
+        throw std::runtime_error("failed to watch " + folder);
+    }
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+    inotify_rm_watch(m_fd, m_watch);
+    close(m_fd);
+}
+
+std::vector<std::string> ShaderWatcher::poll()
+{
+    std::vector<std::string> changed;
+    alignas(inotify_event) char buffer[4096];
+
+    while (true)
+    {
+        ssize_t length = read(m_fd, buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            // EAGAIN: nothing left to read
+            break;
+        }
+
+        for (char* ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(ptr)->len)
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+            if (event->len == 0)
+            {
+                continue;
+            }
+
+            std::string name = event->name;
+            bool is_spirv = name.size() > 4 && name.compare(name.size() - 4, 4, ".spv") == 0;
+            if (is_spirv && std::find(changed.begin(), changed.end(), name) == changed.end())
+            {
+                changed.push_back(name);
+            }
+        }
+    }
+    return changed;
+}
+
+#else
+
+ShaderWatcher::ShaderWatcher(const std::string& folder)
+{
+    throw std::runtime_error("shader hot reload needs inotify, cannot watch " + folder);
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+}
+
+std::vector<std::string> ShaderWatcher::poll()
+{
+    return {};
+}
+
+#endif
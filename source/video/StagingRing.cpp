@@ -0,0 +1,91 @@
+#include "video/StagingRing.h"
+
+StagingRing::StagingRing(VkDeviceSize capacity)
+{
+    m_capacity = capacity;
+    // One element of capacity bytes, an element count would truncate past 4 GiB
+    m_buffer = new Buffer(BufferType::StagingBuffer, 1, static_cast<size_t>(capacity));
+}
+
+StagingRing::~StagingRing()
+{
+    delete m_buffer;
+}
+
+Buffer& StagingRing::getBuffer()
+{
+    return *m_buffer;
+}
+
+VkDeviceSize StagingRing::getCapacity()
+{
+    return m_capacity;
+}
+
+bool StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment, uint64_t ticket, VkDeviceSize& offset)
+{
+    if (m_regions.empty())
+    {
+        m_head = 0;
+        m_tail = 0;
+    }
+
+    VkDeviceSize aligned = (m_head + alignment - 1) / alignment * alignment;
+    if (m_regions.empty() || m_head > m_tail)
+    {
+        // Free space is [head, capacity) and, after wrapping, [0, tail)
+        if (aligned + size <= m_capacity)
+        {
+            offset = aligned;
+        }
+        else if (size < m_tail)
+        {
+            offset = 0;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // Wrapped: free space is [head, tail)
+        if (aligned + size > m_tail)
+        {
+            return false;
+        }
+        offset = aligned;
+    }
+
+    m_head = offset + size;
+    // Regions of the same ticket are recycled together
+    if (!m_regions.empty() && m_regions.back().ticket == ticket && offset != 0)
+    {
+        m_regions.back().end = m_head;
+    }
+    else
+    {
+        m_regions.push_back({ m_head, ticket });
+    }
+    return true;
+}
+
+void StagingRing::retire(uint64_t completed)
+{
+    while (!m_regions.empty() && m_regions.front().ticket <= completed)
+    {
+        m_tail = m_regions.front().end;
+        m_regions.pop_front();
+    }
+}
+
+Buffer* StagingRing::grow(VkDeviceSize capacity)
+{
+    Buffer* old_buffer = m_buffer;
+    m_buffer = new Buffer(BufferType::StagingBuffer, 1, static_cast<size_t>(capacity));
+    m_capacity = capacity;
+    m_head = 0;
+    m_tail = 0;
+    m_regions.clear();
+    return old_buffer;
+}
@@ -0,0 +1,307 @@
+#include "video/UploadManager.h"
+
+#include <stdexcept>
+
+#include "core/Trace.h"
+
+// Staging regions are aligned so copies start on a friendly boundary
+const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+UploadManager::UploadManager(VulkanContext& ctx, VkDeviceSize staging_size, uint32_t ring_size) : m_ctx(ctx)
+{
+    auto transfer_queue = ctx.device.get_dedicated_queue(vkb::QueueType::transfer);
+    m_dedicated = transfer_queue.has_value();
+    if (m_dedicated)
+    {
+        m_queue = transfer_queue.value();
+        m_queue_family = ctx.device.get_dedicated_queue_index(vkb::QueueType::transfer).value();
+    }
+    else
+    {
+        m_queue = ctx.graphics_queue;
+        m_queue_family = ctx.device.get_queue_index(vkb::QueueType::graphics).value();
+    }
+
+    VkCommandPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = m_queue_family;
+    if (ctx.disp.createCommandPool(&pool_info, nullptr, &m_command_pool) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create upload command pool");
+        throw std::runtime_error("failed to create upload command pool");
+    }
+
+    m_batches.resize(ring_size);
+    std::vector<VkCommandBuffer> command_buffers(ring_size);
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_command_pool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = ring_size;
+    if (ctx.disp.allocateCommandBuffers(&allocInfo, command_buffers.data()) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to allocate upload command buffers");
+        throw std::runtime_error("failed to allocate upload command buffers");
+    }
+    for (uint32_t i = 0; i < ring_size; i++)
+    {
+        m_batches[i].command_buffer = command_buffers[i];
+    }
+
+    VkSemaphoreTypeCreateInfo timeline_info = {};
+    timeline_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timeline_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timeline_info.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphore_info = {};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_info.pNext = &timeline_info;
+    if (ctx.disp.createSemaphore(&semaphore_info, nullptr, &m_timeline) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to create upload timeline semaphore");
+        throw std::runtime_error("failed to create upload timeline semaphore");
+    }
+
+    m_staging = new StagingRing(staging_size);
+}
+
+UploadManager::~UploadManager()
+{
+    flush();
+    wait(m_submitted_value);
+    for (auto& batch : m_batches)
+    {
+        releaseBatch(batch);
+    }
+    delete m_staging;
+
+    m_ctx.disp.destroySemaphore(m_timeline, nullptr);
+    m_ctx.disp.destroyCommandPool(m_command_pool, nullptr);
+}
+
+bool UploadManager::isDedicated()
+{
+    return m_dedicated;
+}
+
+uint32_t UploadManager::getQueueFamily()
+{
+    return m_queue_family;
+}
+
+VkSemaphore UploadManager::getSemaphore()
+{
+    return m_timeline;
+}
+
+UploadTicket UploadManager::getSubmittedTicket()
+{
+    return m_submitted_value;
+}
+
+void UploadManager::releaseBatch(Batch& batch)
+{
+    for (auto buffer : batch.released_buffers)
+    {
+        delete buffer;
+    }
+    batch.released_buffers.clear();
+}
+
+bool UploadManager::beginBatch()
+{
+    Batch& batch = m_batches[m_current];
+
+    // Only blocks when every command buffer of the ring is still executing
+    if (batch.value != 0 && wait(batch.value))
+    {
+        return true;
+    }
+    releaseBatch(batch);
+
+    if (m_ctx.disp.resetCommandBuffer(batch.command_buffer, 0) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to reset upload command buffer");
+        return true;
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (m_ctx.disp.beginCommandBuffer(batch.command_buffer, &beginInfo) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to begin upload command buffer");
+        return true;
+    }
+
+    m_recording = true;
+    return false;
+}
+
+UploadTicket UploadManager::upload(const void* content, VkDeviceSize size, VkBuffer dst, VkDeviceSize dst_offset)
+{
+    TRACE_ZONE("upload");
+    if (size == 0 || (!m_recording && beginBatch()))
+    {
+        return 0;
+    }
+    UploadTicket ticket = m_submitted_value + 1;
+
+    VkDeviceSize offset = 0;
+    if (!m_staging->allocate(size, STAGING_ALIGNMENT, ticket, offset))
+    {
+        collect();
+        if (!m_staging->allocate(size, STAGING_ALIGNMENT, ticket, offset))
+        {
+            // Still in use by pending batches: the old buffer lives until the open batch is done
+            VkDeviceSize capacity = m_staging->getCapacity() * 2;
+            while (capacity < size)
+            {
+                capacity *= 2;
+            }
+            try
+            {
+                releaseAfterUpload(m_staging->grow(capacity));
+            }
+            catch(const std::runtime_error& e)
+            {
+                return 0;
+            }
+            SDL_LogInfo(SDL_LOG_CATEGORY_VIDEO, "staging ring grown to %llu bytes", (unsigned long long)capacity);
+            m_staging->allocate(size, STAGING_ALIGNMENT, ticket, offset);
+        }
+    }
+
+    Buffer& staging = m_staging->getBuffer();
+    if (staging.copyToStagingBuffer(content, size, offset))
+    {
+        return 0;
+    }
+
+    VkBufferCopy region{};
+    region.srcOffset = offset;
+    region.dstOffset = dst_offset;
+    region.size = size;
+    return enqueueCopy(staging.getBuffer(), dst, region);
+}
+
+UploadTicket UploadManager::enqueueCopy(VkBuffer src, VkBuffer dst, const VkBufferCopy& region)
+{
+    if (!m_recording && beginBatch())
+    {
+        return 0;
+    }
+
+    m_ctx.disp.cmdCopyBuffer(m_batches[m_current].command_buffer, src, dst, 1, &region);
+    return m_submitted_value + 1;
+}
+
+void UploadManager::releaseAfterUpload(Buffer* buffer)
+{
+    if (!m_recording)
+    {
+        // Nothing pending that could still read it
+        delete buffer;
+        return;
+    }
+    m_batches[m_current].released_buffers.push_back(buffer);
+}
+
+bool UploadManager::flush()
+{
+    TRACE_ZONE("upload flush");
+    if (!m_recording)
+    {
+        return false;
+    }
+
+    Batch& batch = m_batches[m_current];
+    m_recording = false;
+    if (m_ctx.disp.endCommandBuffer(batch.command_buffer) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to record upload command buffer");
+        return true;
+    }
+
+    uint64_t signal_value = m_submitted_value + 1;
+
+    VkTimelineSemaphoreSubmitInfo timeline_info = {};
+    timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_info.signalSemaphoreValueCount = 1;
+    timeline_info.pSignalSemaphoreValues = &signal_value;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timeline_info;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.command_buffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_timeline;
+
+    if (m_ctx.disp.queueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to submit upload batch");
+        return true;
+    }
+
+    batch.value = signal_value;
+    m_submitted_value = signal_value;
+    m_current = (m_current + 1) % m_batches.size();
+    return false;
+}
+
+bool UploadManager::isComplete(UploadTicket ticket)
+{
+    if (ticket > m_submitted_value)
+    {
+        return false;
+    }
+    uint64_t value = 0;
+    m_ctx.disp.getSemaphoreCounterValue(m_timeline, &value);
+    return value >= ticket;
+}
+
+bool UploadManager::wait(UploadTicket ticket)
+{
+    if (ticket == 0)
+    {
+        return false;
+    }
+    if (ticket > m_submitted_value && flush())
+    {
+        return true;
+    }
+
+    VkSemaphoreWaitInfo wait_info = {};
+    wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    wait_info.semaphoreCount = 1;
+    wait_info.pSemaphores = &m_timeline;
+    wait_info.pValues = &ticket;
+    if (m_ctx.disp.waitSemaphores(&wait_info, UINT64_MAX) != VK_SUCCESS)
+    {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "failed to wait for upload");
+        return true;
+    }
+    return false;
+}
+
+void UploadManager::collect()
+{
+    uint64_t value = 0;
+    m_ctx.disp.getSemaphoreCounterValue(m_timeline, &value);
+    m_staging->retire(value);
+    for (uint32_t i = 0; i < m_batches.size(); i++)
+    {
+        // The open batch still holds an old value, its buffers are not uploaded yet
+        if (m_recording && i == m_current)
+        {
+            continue;
+        }
+        if (m_batches[i].value != 0 && m_batches[i].value <= value)
+        {
+            releaseBatch(m_batches[i]);
+        }
+    }
+}
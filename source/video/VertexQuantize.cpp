@@ -0,0 +1,173 @@
+#include "video/VertexQuantize.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VERTEX_QUANTIZE_SSE2
+#endif
+// F16C is not part of the x86-64 baseline, its path is compiled for that
+// target alone and picked at runtime when the CPU has it
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define VERTEX_QUANTIZE_F16C
+#endif
+
+uint16_t float_to_half(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7FFFFFFF;
+
+    if (magnitude >= 0x7F800000)
+    {
+        // Infinity stays infinity, NaN stays a quiet NaN
+        return static_cast<uint16_t>(sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0));
+    }
+    if (magnitude >= 0x477FF000)
+    {
+        // Rounds past 65504, the largest half
+        return static_cast<uint16_t>(sign | 0x7C00);
+    }
+    if (magnitude < 0x38800000)
+    {
+        // Below the smallest normal half: count multiples of 2^-24
+        float absolute;
+        memcpy(&absolute, &magnitude, sizeof(absolute));
+        return static_cast<uint16_t>(sign | static_cast<uint32_t>(std::nearbyint(absolute * 16777216.0f)));
+    }
+
+    // Rebias the exponent from 127 to 15 and round the mantissa, a carry
+    // correctly moves to the next exponent
+    uint32_t half = (magnitude - 0x38000000) >> 13;
+    uint32_t remainder = magnitude & 0x1FFF;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+    {
+        half++;
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+#ifdef VERTEX_QUANTIZE_F16C
+// Converts the multiple of 4 floats at the start, returns how many it did
+__attribute__((target("f16c"))) static size_t encode_half_f16c(const float* input, uint16_t* output, size_t count)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i half = _mm_cvtps_ph(_mm_loadu_ps(input + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(output + i), half);
+    }
+    return i;
+}
+#endif
+
+void encode_half(const float* input, uint16_t* output, size_t count)
+{
+    size_t i = 0;
+#ifdef VERTEX_QUANTIZE_F16C
+    static const bool has_f16c = __builtin_cpu_supports("f16c");
+    if (has_f16c)
+    {
+        i = encode_half_f16c(input, output, count);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        output[i] = float_to_half(input[i]);
+    }
+}
+
+void encode_unorm8(const float* input, uint8_t* output, size_t count)
+{
+    size_t i = 0;
+#ifdef VERTEX_QUANTIZE_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    auto convert = [&](const float* values) {
+        __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(values), zero), one);
+        return _mm_cvtps_epi32(_mm_mul_ps(clamped, scale));
+    };
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i low = _mm_packs_epi32(convert(input + i), convert(input + i + 4));
+        __m128i high = _mm_packs_epi32(convert(input + i + 8), convert(input + i + 12));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(low, high));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        float clamped = std::min(std::max(input[i], 0.0f), 1.0f);
+        output[i] = static_cast<uint8_t>(std::nearbyint(clamped * 255.0f));
+    }
+}
+
+int16_t encode_snorm16(float value)
+{
+    float clamped = std::min(std::max(value, -1.0f), 1.0f);
+    return static_cast<int16_t>(std::nearbyint(clamped * 32767.0f));
+}
+
+void encode_octahedral(const float* normals, int16_t* output, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        float x = normals[i * 3];
+        float y = normals[i * 3 + 1];
+        float z = normals[i * 3 + 2];
+
+        // Project onto the octahedron |x| + |y| + |z| = 1
+        float length = std::fabs(x) + std::fabs(y) + std::fabs(z);
+        if (length > 0.0f)
+        {
+            x /= length;
+            y /= length;
+            z /= length;
+        }
+
+        // Fold the lower hemisphere over the diagonals
+        if (z < 0.0f)
+        {
+            float folded_x = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float folded_y = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = folded_x;
+            y = folded_y;
+        }
+
+        output[i * 2] = encode_snorm16(x);
+        output[i * 2 + 1] = encode_snorm16(y);
+    }
+}
+
+void quantize_vertices(const std::vector<Vertex>& vertices, std::vector<CompactVertex>& compact)
+{
+    // Deinterleave so each attribute is encoded in one SIMD friendly batch
+    size_t count = vertices.size();
+    std::vector<float> positions(count * 2);
+    std::vector<float> colors(count * 4);
+    for (size_t i = 0; i < count; i++)
+    {
+        positions[i * 2] = vertices[i].pos.x;
+        positions[i * 2 + 1] = vertices[i].pos.y;
+        colors[i * 4] = vertices[i].color.r;
+        colors[i * 4 + 1] = vertices[i].color.g;
+        colors[i * 4 + 2] = vertices[i].color.b;
+        colors[i * 4 + 3] = 1.0f;
+    }
+
+    std::vector<uint16_t> half_positions(count * 2);
+    std::vector<uint8_t> unorm_colors(count * 4);
+    encode_half(positions.data(), half_positions.data(), positions.size());
+    encode_unorm8(colors.data(), unorm_colors.data(), colors.size());
+
+    compact.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        memcpy(compact[i].pos, &half_positions[i * 2], sizeof(compact[i].pos));
+        memcpy(compact[i].color, &unorm_colors[i * 4], sizeof(compact[i].color));
+    }
+}
@@ -17,11 +17,15 @@ static VmaAllocator allocator;
 
 bool createAllocator(VulkanContext ctx)
 {
-    vulkanFunctions.vkGetInstanceProcAddr = (PFN_vkGetInstanceProcAddr)SDL_Vulkan_GetVkGetInstanceProcAddr();
+    // Taken from the instance so that headless mode works without SDL video
+    vulkanFunctions.vkGetInstanceProcAddr = ctx.instance.fp_vkGetInstanceProcAddr;
     vulkanFunctions.vkGetDeviceProcAddr = &vkGetDeviceProcAddr;
 
     VmaAllocatorCreateInfo allocatorCreateInfo = {};
-    allocatorCreateInfo.flags = VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    if (ctx.memory_budget)
+    {
+        allocatorCreateInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    }
     allocatorCreateInfo.vulkanApiVersion = VK_API_VERSION_1_2;
     allocatorCreateInfo.physicalDevice = ctx.device.physical_device;
     allocatorCreateInfo.device = ctx.device.device;
@@ -51,4 +55,43 @@ bool destroyAllocator()
     allocatorCreated = false;
     vmaDestroyAllocator(allocator);
     return false;
+}
+
+void updateAllocatorBudgets(uint64_t frame_number, std::vector<HeapBudget>& budgets)
+{
+    vmaSetCurrentFrameIndex(allocator, static_cast<uint32_t>(frame_number));
+
+    const VkPhysicalDeviceMemoryProperties* properties = nullptr;
+    vmaGetMemoryProperties(allocator, &properties);
+    VmaBudget heap_budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetHeapBudgets(allocator, heap_budgets);
+
+    budgets.resize(properties->memoryHeapCount);
+    for (uint32_t heap = 0; heap < properties->memoryHeapCount; heap++)
+    {
+        const VmaBudget& source = heap_budgets[heap];
+        HeapBudget& budget = budgets[heap];
+        budget.budget = source.budget;
+        budget.usage = source.usage;
+        budget.block_bytes = source.statistics.blockBytes;
+        budget.allocation_bytes = source.statistics.allocationBytes;
+        budget.allocation_count = source.statistics.allocationCount;
+        budget.device_local = (properties->memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+}
+
+uint32_t getAllocationCount()
+{
+    VmaTotalStatistics statistics;
+    vmaCalculateStatistics(allocator, &statistics);
+    return statistics.total.statistics.allocationCount;
+}
+
+std::string buildAllocatorStatsString(bool detailed)
+{
+    char* stats = nullptr;
+    vmaBuildStatsString(allocator, &stats, detailed ? VK_TRUE : VK_FALSE);
+    std::string result = stats;
+    vmaFreeStatsString(allocator, stats);
+    return result;
 }
\ No newline at end of file
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "video/MeshOptimizer.h"
+#include "video/Vertex.h"
+
+// Checks of the CPU mesh passes, run by ctest. Prints each failed check
+// and exits non zero if any failed.
+
+static int failures = 0;
+
+#define CHECK(condition)                                                    \
+    do                                                                      \
+    {                                                                       \
+        if (!(condition))                                                   \
+        {                                                                   \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+typedef std::array<uint32_t, 3> Triangle;
+
+bool same_vertex(const Vertex& a, const Vertex& b)
+{
+    return memcmp(&a, &b, sizeof(Vertex)) == 0;
+}
+
+Vertex make_vertex(float x, float y)
+{
+    Vertex vertex = {};
+    vertex.pos = glm::vec2(x, y);
+    vertex.color = glm::vec3(x, y, 1.0f);
+    return vertex;
+}
+
+// Rotated so the smallest index comes first, which keeps the winding
+Triangle canonical(uint32_t a, uint32_t b, uint32_t c)
+{
+    if (b < a && b <= c)
+    {
+        return { b, c, a };
+    }
+    if (c < a && c < b)
+    {
+        return { c, a, b };
+    }
+    return { a, b, c };
+}
+
+std::vector<Triangle> sorted_triangles(const std::vector<uint32_t>& indices)
+{
+    std::vector<Triangle> triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        triangles.push_back(canonical(indices[i], indices[i + 1], indices[i + 2]));
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+// size x size quads of two triangles each, in shuffled order
+void make_grid(uint32_t size, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    vertices.clear();
+    for (uint32_t y = 0; y <= size; y++)
+    {
+        for (uint32_t x = 0; x <= size; x++)
+        {
+            vertices.push_back(make_vertex(float(x), float(y)));
+        }
+    }
+
+    std::vector<Triangle> triangles;
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            uint32_t corner = y * (size + 1) + x;
+            triangles.push_back({ corner, corner + 1, corner + size + 2 });
+            triangles.push_back({ corner, corner + size + 2, corner + size + 1 });
+        }
+    }
+    std::mt19937 random(42);
+    std::shuffle(triangles.begin(), triangles.end(), random);
+
+    indices.clear();
+    for (const Triangle& triangle : triangles)
+    {
+        indices.insert(indices.end(), triangle.begin(), triangle.end());
+    }
+}
+
+void test_deduplicate_vertices()
+{
+    // A quad as an unindexed list of two triangles, two corners repeated
+    const std::vector<Vertex> original = {
+        make_vertex(0, 0), make_vertex(1, 0), make_vertex(1, 1),
+        make_vertex(1, 1), make_vertex(0, 1), make_vertex(0, 0),
+    };
+    std::vector<Vertex> vertices = original;
+    std::vector<uint32_t> indices;
+    deduplicate_vertices(vertices, indices);
+
+    CHECK(vertices.size() == 4);
+    CHECK(indices.size() == original.size());
+    for (size_t i = 0; i < indices.size() && i < original.size(); i++)
+    {
+        CHECK(indices[i] < vertices.size());
+        CHECK(indices[i] < vertices.size() && same_vertex(vertices[indices[i]], original[i]));
+    }
+
+    // Indexed input: each index is remapped to its unique copy
+    vertices = original;
+    std::vector<uint32_t> indexed = { 5, 1, 2, 3, 4, 0 };
+    indices = indexed;
+    deduplicate_vertices(vertices, indices);
+    CHECK(vertices.size() == 4);
+    CHECK(indices[0] == indices[5]);
+    CHECK(indices[2] == indices[3]);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        CHECK(indices[i] < vertices.size() && same_vertex(vertices[indices[i]], original[indexed[i]]));
+    }
+}
+
+void test_vertex_cache_miss_ratio()
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    make_grid(32, vertices, indices);
+    uint32_t vertex_count = static_cast<uint32_t>(vertices.size());
+
+    float before = average_cache_miss_ratio(indices, vertex_count);
+    optimize_vertex_cache(indices, vertex_count);
+    float after = average_cache_miss_ratio(indices, vertex_count);
+    CHECK(after <= before);
+    // A shuffled grid is close to the worst case, an optimized one well under 1
+    CHECK(after < 1.0f);
+
+    // Optimizing an optimized order does not make it worse
+    optimize_vertex_cache(indices, vertex_count);
+    CHECK(average_cache_miss_ratio(indices, vertex_count) <= after + 0.01f);
+}
+
+void test_vertex_cache_keeps_triangles()
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    make_grid(8, vertices, indices);
+    // Degenerate triangles are kept like any other
+    indices.insert(indices.end(), { 3, 3, 7, 10, 10, 10, 4, 5, 4 });
+
+    std::vector<Triangle> before = sorted_triangles(indices);
+    optimize_vertex_cache(indices, static_cast<uint32_t>(vertices.size()));
+    CHECK(indices.size() == before.size() * 3);
+    CHECK(sorted_triangles(indices) == before);
+}
+
+void test_vertex_fetch()
+{
+    std::vector<Vertex> original;
+    std::vector<uint32_t> original_indices;
+    make_grid(8, original, original_indices);
+    // Never referenced, dropped
+    original.push_back(make_vertex(-1, -1));
+
+    std::vector<Vertex> vertices = original;
+    std::vector<uint32_t> indices = original_indices;
+    std::vector<uint32_t> remap = optimize_vertex_fetch(vertices, indices);
+
+    CHECK(vertices.size() == original.size() - 1);
+    CHECK(remap.size() == original.size());
+    CHECK(remap.back() == UINT32_MAX);
+    CHECK(indices.size() == original_indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        CHECK(indices[i] < vertices.size());
+        CHECK(remap[original_indices[i]] == indices[i]);
+        CHECK(indices[i] < vertices.size() && same_vertex(vertices[indices[i]], original[original_indices[i]]));
+    }
+
+    // Vertices are in order of first use
+    uint32_t next = 0;
+    for (uint32_t index : indices)
+    {
+        CHECK(index <= next);
+        next = std::max(next, index + 1);
+    }
+}
+
+void test_optimize_mesh()
+{
+    std::vector<Vertex> original;
+    std::vector<uint32_t> original_indices;
+    make_grid(16, original, original_indices);
+    // Duplicate the first vertex and point a triangle at the copy
+    original.push_back(original[0]);
+    original_indices.insert(original_indices.end(), { static_cast<uint32_t>(original.size() - 1), 1, 2 });
+
+    std::vector<Vertex> vertices = original;
+    std::vector<uint32_t> indices = original_indices;
+    optimize_mesh(vertices, indices);
+
+    CHECK(vertices.size() == original.size() - 1);
+    CHECK(indices.size() == original_indices.size());
+
+    // Same triangles, compared by their corners' vertices
+    auto corners = [](const std::vector<Vertex>& mesh_vertices, const std::vector<uint32_t>& mesh_indices) {
+        std::vector<std::array<float, 6>> triangles;
+        for (size_t i = 0; i + 2 < mesh_indices.size(); i += 3)
+        {
+            std::array<float, 6> positions;
+            // Rotate by position so the comparison does not depend on indices
+            std::array<glm::vec2, 3> p = { mesh_vertices[mesh_indices[i]].pos,
+                                           mesh_vertices[mesh_indices[i + 1]].pos,
+                                           mesh_vertices[mesh_indices[i + 2]].pos };
+            auto less = [](glm::vec2 a, glm::vec2 b) { return a.x < b.x || (a.x == b.x && a.y < b.y); };
+            uint32_t first = 0;
+            for (uint32_t k = 1; k < 3; k++)
+            {
+                if (less(p[k], p[first]))
+                {
+                    first = k;
+                }
+            }
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                positions[k * 2] = p[(first + k) % 3].x;
+                positions[k * 2 + 1] = p[(first + k) % 3].y;
+            }
+            triangles.push_back(positions);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    };
+    CHECK(corners(vertices, indices) == corners(original, original_indices));
+}
+
+int main()
+{
+    test_deduplicate_vertices();
+    test_vertex_cache_miss_ratio();
+    test_vertex_cache_keeps_triangles();
+    test_vertex_fetch();
+    test_optimize_mesh();
+
+    if (failures > 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("mesh optimizer: all checks passed\n");
+    return 0;
+}